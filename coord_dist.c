@@ -22,41 +22,422 @@ SOFTWARE.
 
 #include <math.h>
 #include "coord_dist.h"
+#include "trig.h"
 
 const float EARTH_RADIUS = 6372797.560856; //in meters
-const float TO_RAD = M_PI/180;
+//converts fixed point degrees straight to radians
+const float COORD_TO_RAD = M_PI/180/COORD_PER_DEG;
 const float TO_DEG = 180/M_PI;
+//the circumference of the earth, for converting binary angles to distances
+// (2*pi*EARTH_RADIUS, one binary angle unit is this divided by 2^32)
+static const uint32_t EARTH_CIRCUMFERENCE = 4004146800UL; //in centimeters
+//how far the fixed point flat model can be from the exact equirectangular,
+// in meters plus a fraction of the distance (rounding to whole meters, and
+// the sine table's interpolation in cos(lat), as measured on the build host)
+const float DIST_FLAT_KERNEL_ERROR = 0.6;
+const float DIST_FLAT_KERNEL_SCALE = 6e-6;
 
-//converts from degrees, minutes, seconds to decimal degrees
-float to_deg(int degrees, int minutes, int seconds){
-  return (degrees+(minutes/60.0)+(seconds/3600.0));
+//WGS84 ellipsoid, for the precise model
+const float WGS84_A = 6378137.0; //equatorial radius in meters
+const float WGS84_F = 1/298.257223563; //flattening
+
+//the model selection state
+//  the flat model is used out to dist_flat_limit meters, which depends on
+//  the latitude, so it is worked out once for a band of latitudes
+//  [dist_band_lo, dist_band_hi) and reused until we leave it
+static uint16_t dist_error_bound = DIST_DEFAULT_ERROR_BOUND;
+static uint8_t dist_precise = 0;
+static uint32_t dist_flat_limit = 0;
+static int32_t dist_band_lo = 0;
+static int32_t dist_band_hi = 0; //empty band, forces the first calculation
+
+//converts from degrees, minutes, seconds to fixed point degrees
+int32_t to_deg(int degrees, int minutes, int seconds){
+  return ( degrees*COORD_PER_DEG +
+           (minutes*COORD_PER_DEG)/60 +
+           (seconds*COORD_PER_DEG)/3600 );
+}
+
+//finds how far east long2 is from long1, going the short way around
+//  returns int32_t - the difference, from -180 to 180 degrees
+int32_t coord_delta_long(int32_t long1, int32_t long2){
+  //the raw difference can be up to 360 degrees, which doesn't fit in 32 bits
+  int64_t delta = (int64_t)long2 - long1;
+
+  if( delta > 180*COORD_PER_DEG ){
+    delta -= 360*COORD_PER_DEG;
+  } else if( delta < -180*COORD_PER_DEG ){
+    delta += 360*COORD_PER_DEG;
+  }
+
+  return (int32_t)delta;
 }
 
 //calculates distance between two coordinates (lat1,long1) and (lat2,long2)
-float get_distance(float lat1, float long1,
-                    float lat2, float long2){
+//  returns uint32_t - the distance in meters
+uint32_t get_distance(int32_t lat1, int32_t long1,
+                      int32_t lat2, int32_t long2){
   //Haversine implementation stolen from somewhere
-  lat1 *= TO_RAD; long1 *= TO_RAD; lat2 *= TO_RAD; long2 *= TO_RAD;
+  //(the differences are taken in fixed point so they keep full precision)
+  float lat1r = lat1*COORD_TO_RAD;
+  float lat2r = lat2*COORD_TO_RAD;
 
-  float latH = sin( (lat2-lat1)/2 );
+  float latH = sin( (lat2-lat1)*COORD_TO_RAD/2 );
   latH *= latH;
 
-  float longH = sin( (long2-long1)/2 );
+  float longH = sin( coord_delta_long(long1, long2)*COORD_TO_RAD/2 );
   longH *= longH;
 
-  float arcLength = cos(lat1) * cos(lat2);
+  float arcLength = cos(lat1r) * cos(lat2r);
   arcLength = 2.0 * asin(sqrt(latH+arcLength*longH));
 
-  return arcLength*EARTH_RADIUS;
+  return (uint32_t)(arcLength*EARTH_RADIUS + 0.5);
 }
 
 //calulates the forward azimuth given two points
-float get_fwd_azimuth(float lat1, float long1,
-                       float lat2, float long2){
-  lat1 *= TO_RAD; long1 *= TO_RAD; lat2 *= TO_RAD; long2 *= TO_RAD;
+//  returns int16_t - the azimuth in degrees, from -180 to 180
+int16_t get_fwd_azimuth(int32_t lat1, int32_t long1,
+                        int32_t lat2, int32_t long2){
+  float lat1r = lat1*COORD_TO_RAD;
+  float lat2r = lat2*COORD_TO_RAD;
+  float dlong = coord_delta_long(long1, long2)*COORD_TO_RAD;
+
+  float y = sin(dlong) * cos(lat2r);
+  float x = cos(lat1r)*sin(lat2r) - sin(lat1r)*cos(lat2r)*cos(dlong);
+
+  return (int16_t)(atan2(y, x)*TO_DEG);
+}
+
+//the haversine distance, given the cosines of both latitudes
+//  int32_t cosLat1, cosLat2 - cos(lat1) and cos(lat2), in Q30
+//  returns uint32_t - the distance in meters
+static uint32_t dist_sphere(int32_t lat1, int32_t long1, int32_t cosLat1,
+                            int32_t lat2, int32_t long2, int32_t cosLat2){
+  //half angles are taken on the differences, where the precision is
+  // (shifting the signed angle keeps the sign)
+  angle_t halfLat = (int32_t)trig_coord_to_angle(lat2-lat1) >> 1;
+  angle_t halfLong =
+    (int32_t)trig_coord_to_angle(coord_delta_long(long1, long2)) >> 1;
+  int32_t latH, longH, cosHalfArc;
+  uint32_t sinHalfArc;
+  uint8_t cosShift = 0;
+  uint8_t shift = 0;
+  angle_t halfArc;
+
+  //near the poles both cosines are small, and their product in Q30 would
+  // have hardly any bits left, so scale them up together first (the square
+  // root of the product is then scaled by 2^cosShift)
+  while( (cosShift < 30) &&
+         (cosLat1 < 0x20000000L) && (cosLat2 < 0x20000000L) ){
+    cosLat1 <<= 1;
+    cosLat2 <<= 1;
+    cosShift++;
+  }
+
+  //the haversine of the central angle is latH^2 + longH^2, with
+  latH = trig_sin(halfLat);
+  longH = trig_mul( trig_sin(halfLong),
+                    trig_sqrt(trig_mul(cosLat1, cosLat2)) >> cosShift );
+
+  //squaring small Q30 numbers throws their bits away, so scale both up
+  // first (atan2 below only cares about the ratio)
+  while( (shift < 30) &&
+         (latH < 0x20000000L) && (latH > -0x20000000L) &&
+         (longH < 0x20000000L) && (longH > -0x20000000L) ){
+    latH <<= 1;
+    longH <<= 1;
+    shift++;
+  }
+
+  //sin of half the central angle, scaled by 2^shift
+  sinHalfArc = trig_sqrt( (uint32_t)trig_mul(latH, latH) +
+                          (uint32_t)trig_mul(longH, longH) );
+  //...and the cos, which is close enough to 1 not to need scaling
+  cosHalfArc = sinHalfArc >> shift;
+  cosHalfArc = trig_sqrt( TRIG_ONE - trig_mul(cosHalfArc, cosHalfArc) );
+
+  //asin(s) is atan(s/sqrt(1-s^2)), and atan is what we have
+  if( shift == 0 ){
+    halfArc = trig_atan2( sinHalfArc, cosHalfArc );
+  } else {
+    //if it needed scaling, s is under sqrt(1/2) and the ratio is under 1
+    halfArc = trig_atan( trig_div(sinHalfArc, cosHalfArc) >> shift );
+  }
+
+  //the central angle is twice that, as a binary angle of the circumference
+  return ( trig_arc(halfArc << 1, EARTH_CIRCUMFERENCE) + 50 )/100;
+}
+
+//the forward azimuth on a sphere, given the sines and cosines of both
+//latitudes
+//  int32_t sinLat1, cosLat1, sinLat2, cosLat2 - in Q30
+//  returns int16_t - the azimuth in degrees, from -180 to 180
+static int16_t azimuth_sphere(int32_t long1, int32_t sinLat1, int32_t cosLat1,
+                              int32_t long2, int32_t sinLat2, int32_t cosLat2){
+  angle_t dlong = trig_coord_to_angle(coord_delta_long(long1, long2));
+
+  int32_t y = trig_mul(trig_sin(dlong), cosLat2);
+  int32_t x = trig_mul(cosLat1, sinLat2) -
+              trig_mul(trig_mul(sinLat1, cosLat2), trig_cos(dlong));
+
+  return trig_angle_to_deg( trig_atan2(y, x) );
+}
+
+//calculates distance between two coordinates (lat1,long1) and (lat2,long2)
+//using only integer math (see trig.h)
+//  (NOTE: within 0.6m plus 0.002% of the exact haversine up to 10000km, and
+//   within 0.15% from there to the antipode, as measured on the build host)
+//  returns uint32_t - the distance in meters
+uint32_t get_distance_fixed(int32_t lat1, int32_t long1,
+                            int32_t lat2, int32_t long2){
+  return dist_sphere( lat1, long1, trig_cos(trig_coord_to_angle(lat1)),
+                      lat2, long2, trig_cos(trig_coord_to_angle(lat2)) );
+}
+
+//calulates the forward azimuth given two points using only integer math
+//  (NOTE: within 1 degree of the exact azimuth, rounding included, when the
+//   points are more than 5m apart)
+//  returns int16_t - the azimuth in degrees, from -180 to 180
+int16_t get_fwd_azimuth_fixed(int32_t lat1, int32_t long1,
+                              int32_t lat2, int32_t long2){
+  angle_t lat1a = trig_coord_to_angle(lat1);
+  angle_t lat2a = trig_coord_to_angle(lat2);
+
+  return azimuth_sphere( long1, trig_sin(lat1a), trig_cos(lat1a),
+                         long2, trig_sin(lat2a), trig_cos(lat2a) );
+}
+
+//converts a difference of coordinates into a distance along a great circle
+//  int32_t delta - the difference, from -180 to 180 degrees
+//  returns int32_t - the distance in centimeters, with the sign of delta
+static int32_t coord_to_cm(int32_t delta){
+  int32_t cm = trig_arc( trig_coord_to_angle( (delta < 0) ? -delta : delta ),
+                         EARTH_CIRCUMFERENCE );
+
+  return (delta < 0) ? -cm : cm;
+}
+
+//calculates distance and azimuth with the equirectangular approximation
+//  uint32_t* distance - where to store the distance in meters
+//  int16_t* azimuth - where to store the azimuth in degrees
+static void get_dist_azimuth_flat(int32_t lat1, int32_t long1,
+                                  int32_t lat2, int32_t long2,
+                                  uint32_t* distance, int16_t* azimuth){
+  //lines of longitude get closer together by cos(latitude)
+  int32_t cosLat = trig_cos( trig_coord_to_angle(lat1/2 + lat2/2) );
+  //east and north components, in centimeters
+  int32_t x = trig_mul( coord_to_cm(coord_delta_long(long1, long2)), cosLat );
+  int32_t y = coord_to_cm(lat2-lat1);
+  uint32_t ax = (x < 0) ? -(uint32_t)x : (uint32_t)x;
+  uint32_t ay = (y < 0) ? -(uint32_t)y : (uint32_t)y;
+  uint32_t ratio;
+
+  //hypot(x,y) is big*sqrt(1+(small/big)^2), which never overflows, and is
+  // big plus big*(that root - 1) so the multiply stays in Q30
+  if( ax < ay ){
+    ratio = ax;
+    ax = ay;
+    ay = ratio;
+  }
+  if( ax == 0 ){
+    *distance = 0;
+  } else {
+    ratio = trig_div(ay, ax);
+    ratio = trig_sqrt( TRIG_ONE + trig_mul(ratio, ratio) );
+    *distance = ( ax + trig_mul(ax, ratio - TRIG_ONE) + 50 ) / 100;
+  }
+
+  *azimuth = trig_angle_to_deg( trig_atan2(x, y) );
+}
+
+//works out how far the flat model can be used for a band of latitudes
+//  (NOTE: uses floats, but only when the latitude band or error bound
+//   changes)
+//  int32_t lat - a latitude in the band
+static void dist_update_flat_limit(int32_t lat){
+  float maxLat, cosLat2, sinLat2, bound, scale, lo, hi, d;
+  uint8_t i;
+
+  //bands are whole degrees, and the worst case for the band is its edge
+  // nearest a pole
+  if( lat < 0 ){
+    lat = -lat;
+  }
+  dist_band_lo = (lat/COORD_PER_DEG)*COORD_PER_DEG;
+  dist_band_hi = dist_band_lo + COORD_PER_DEG;
+  maxLat = dist_band_hi*COORD_TO_RAD;
+
+  //the fixed point kernel takes its own share of the bound before the model
+  // gets any
+  bound = dist_error_bound - DIST_FLAT_KERNEL_ERROR;
+  if( bound <= 0 ){
+    dist_flat_limit = 0;
+    return;
+  }
+
+  //compared to the haversine, the flat model is off by at most
+  //  d^3*(1+5*tan(lat)^2)/(96*R^2)
+  // where lat is the furthest either end gets from the equator, so a first
+  // guess takes lat at the band's edge and solves for d, writing tan^2 as
+  // sin^2/cos^2
+  scale = 96.0*EARTH_RADIUS*EARTH_RADIUS;
+  cosLat2 = cos(maxLat);
+  cosLat2 *= cosLat2;
+  sinLat2 = 1 - cosLat2;
+  hi = cbrt( bound*scale*cosLat2/(cosLat2 + 5*sinLat2) );
+
+  //the other end can be that much closer to the pole, and the kernel is off
+  // by DIST_FLAT_KERNEL_SCALE of the distance as well, both only shrink the
+  // answer so it's found between 0 and the first guess
+  maxLat += hi/EARTH_RADIUS;
+  if( maxLat > M_PI/2 ){
+    maxLat = M_PI/2;
+  }
+  cosLat2 = cos(maxLat);
+  cosLat2 *= cosLat2;
+  sinLat2 = 1 - cosLat2;
+  lo = 0;
+  for( i = 0; i < 24; i++ ){
+    d = (lo + hi)/2;
+    if( d*d*d*(cosLat2 + 5*sinLat2) <=
+        (bound - DIST_FLAT_KERNEL_SCALE*d)*scale*cosLat2 ){
+      lo = d;
+    } else {
+      hi = d;
+    }
+  }
+  dist_flat_limit = lo;
+}
+
+//finds the reduced latitude on WGS84, which Lambert's formula works with
+//  returns float - the reduced latitude in radians
+static float reduced_lat(int32_t lat){
+  return atan( (1-WGS84_F)*tan(lat*COORD_TO_RAD) );
+}
+
+//Lambert's formula, given the reduced latitude of the second point
+//  float beta2, cosBeta2 - the reduced latitude of (lat2,long2) and its cos
+//  returns uint32_t - the distance in meters
+static uint32_t dist_ellipsoid(int32_t lat1, int32_t long1,
+                               int32_t lat2, int32_t long2,
+                               float beta2, float cosBeta2){
+  float beta1 = reduced_lat(lat1);
+  float meanLat = (lat1/2 + lat2/2)*COORD_TO_RAD;
+  float cosMean = cos(meanLat);
+  float sinMean = sin(meanLat);
+  float P, Q, h, sigma, sinSigma, X, Y;
+
+  //half their difference, scaled from the fixed point difference by
+  // dbeta/dlat so it keeps its precision
+  Q = (lat2-lat1)*COORD_TO_RAD/2 * (1-WGS84_F) /
+      ( cosMean*cosMean + (1-WGS84_F)*(1-WGS84_F)*sinMean*sinMean );
+  P = (beta1+beta2)/2;
+
+  //central angle on the auxiliary sphere
+  h = sin( coord_delta_long(long1, long2)*COORD_TO_RAD/2 );
+  h = sin(Q)*sin(Q) + cos(beta1)*cosBeta2*h*h;
+  if( (h <= 0) || (h >= 1) ){ //same point or antipodes, where it breaks
+    return get_distance(lat1, long1, lat2, long2);
+  }
+  sigma = 2.0 * asin(sqrt(h));
+  sinSigma = sin(sigma);
+
+  //sin^2(sigma/2) is h, and cos^2(sigma/2) is 1-h
+  X = (sigma-sinSigma) * sin(P)*sin(P)*cos(Q)*cos(Q) / (1-h);
+  Y = (sigma+sinSigma) * cos(P)*cos(P)*sin(Q)*sin(Q) / h;
+
+  return (uint32_t)( WGS84_A*(sigma - WGS84_F/2*(X+Y)) + 0.5 );
+}
+
+//calculates distance between two coordinates on the WGS84 ellipsoid
+//  (NOTE: Lambert's formula, within about 10m over thousands of kilometers,
+//   uses floats)
+//  returns uint32_t - the distance in meters
+uint32_t get_distance_ellipsoid(int32_t lat1, int32_t long1,
+                                int32_t lat2, int32_t long2){
+  float beta2 = reduced_lat(lat2);
+
+  return dist_ellipsoid(lat1, long1, lat2, long2, beta2, cos(beta2));
+}
+
+//sets how far the flat model is allowed to be from the haversine before the
+//haversine is used instead
+//  uint16_t meters - the error bound
+void dist_set_error_bound(uint16_t meters){
+  dist_error_bound = meters;
+  //force the limit to be worked out again
+  dist_band_hi = dist_band_lo;
+}
+
+//turns the ellipsoid model on or off
+//  uint8_t precise - 1 to always use the ellipsoid model, 0 for the cheapest
+//    good enough model
+void dist_set_precise(uint8_t precise){
+  dist_precise = precise;
+}
+
+//returns uint8_t - 1 if the ellipsoid model is on, 0 otherwise
+uint8_t dist_get_precise(){
+  return dist_precise;
+}
+
+//works out everything about the destination that doesn't depend on where we
+//are, so it can be reused for every fix until the destination changes
+//  (NOTE: uses floats for the ellipsoid model's terms)
+//  dest_geom_t* dest - where to store it
+//  int32_t lat, lon - the destination
+void dest_geom_init(dest_geom_t* dest, int32_t lat, int32_t lon){
+  angle_t latAngle = trig_coord_to_angle(lat);
+
+  dest->lat = lat;
+  dest->lon = lon;
+  dest->sinLat = trig_sin(latAngle);
+  dest->cosLat = trig_cos(latAngle);
+  dest->beta = reduced_lat(lat);
+  dest->cosBeta = cos(dest->beta);
+}
+
+//calculates distance and azimuth to the destination with the cheapest model
+//that meets the error bound, or with the ellipsoid if precision was asked for
+//  const dest_geom_t* dest - the destination (see dest_geom_init)
+//  int32_t lat, lon - where we are
+//  uint32_t* distance - where to store the distance in meters
+//  int16_t* azimuth - where to store the forward azimuth in degrees
+//  returns uint8_t - the DIST_MODEL_* that was used
+uint8_t get_dist_azimuth(const dest_geom_t* dest, int32_t lat, int32_t lon,
+                         uint32_t* distance, int16_t* azimuth){
+  int32_t absLat = (lat < 0) ? -lat : lat;
+  angle_t latAngle;
+  int32_t sinLat, cosLat;
+  uint8_t model;
 
-  float y = sin(long2-long1) * cos(lat2);
-  float x = cos(lat1)*sin(lat2) - sin(lat1)*cos(lat2)*cos(long2-long1);
+  if( dist_precise ){
+    *distance = dist_ellipsoid(lat, lon, dest->lat, dest->lon,
+                               dest->beta, dest->cosBeta);
+    model = DIST_MODEL_ELLIPSOID;
+  } else {
+    //the flat model is cheap enough to try first, its answer says whether
+    // it was good enough
+    get_dist_azimuth_flat(lat, lon, dest->lat, dest->lon, distance, azimuth);
+    if( (absLat < dist_band_lo) || (absLat >= dist_band_hi) ){
+      dist_update_flat_limit(absLat);
+    }
+    //(the limit already allows for the other end being nearer a pole)
+    if( *distance <= dist_flat_limit ){
+      return DIST_MODEL_FLAT;
+    }
+    model = DIST_MODEL_SPHERE;
+  }
 
-  return atan2(y, x)*TO_DEG;
+  //only our end of the sphere needs its trig done
+  latAngle = trig_coord_to_angle(lat);
+  sinLat = trig_sin(latAngle);
+  cosLat = trig_cos(latAngle);
+  if( model == DIST_MODEL_SPHERE ){
+    *distance = dist_sphere(lat, lon, cosLat,
+                            dest->lat, dest->lon, dest->cosLat);
+  }
+  *azimuth = azimuth_sphere(lon, sinLat, cosLat,
+                            dest->lon, dest->sinLat, dest->cosLat);
+  return model;
 }
@@ -23,15 +23,95 @@ SOFTWARE.
 #ifndef __COORD_DIST_H
 #define __COORD_DIST_H
 
-//converts from degrees, minutes, seconds to decimal degrees
-float to_deg(int degrees, int minutes, int seconds);
+#include <inttypes.h>
+
+//coordinates are fixed point, in units of 1e-7 degrees
+#define COORD_PER_DEG 10000000L
+
+//distance models, from cheapest to most precise
+#define DIST_MODEL_FLAT      0 //equirectangular, for short distances
+#define DIST_MODEL_SPHERE    1 //haversine
+#define DIST_MODEL_ELLIPSOID 2 //Lambert's formula on WGS84, uses floats
+
+//how far (in meters) the flat model may be from the haversine by default
+#define DIST_DEFAULT_ERROR_BOUND 1
+
+//the destination's half of the distance and azimuth math
+//  (NOTE: only changes when the destination does, see dest_geom_init)
+struct dest_geom {
+  int32_t lat, lon; //in units of 1e-7 degrees
+  int32_t sinLat, cosLat; //Q30 (see trig.h)
+  float beta, cosBeta; //reduced latitude on WGS84, for the ellipsoid model
+};
+typedef struct dest_geom dest_geom_t;
+
+//converts from degrees, minutes, seconds to fixed point degrees
+int32_t to_deg(int degrees, int minutes, int seconds);
+
+//finds how far east long2 is from long1, going the short way around
+//  returns int32_t - the difference, from -180 to 180 degrees
+int32_t coord_delta_long(int32_t long1, int32_t long2);
 
 //calculates distance between two coordinates (lat1,long1) and (lat2,long2)
-float get_distance(float lat1, float long1,
-                    float lat2, float long2);
+//  returns uint32_t - the distance in meters
+uint32_t get_distance(int32_t lat1, int32_t long1,
+                      int32_t lat2, int32_t long2);
 
 //calulates the forward azimuth given two points
-float get_fwd_azimuth(float lat1, float long1,
-                       float lat2, float long2);
+//  returns int16_t - the azimuth in degrees, from -180 to 180
+int16_t get_fwd_azimuth(int32_t lat1, int32_t long1,
+                        int32_t lat2, int32_t long2);
+
+//calculates distance between two coordinates (lat1,long1) and (lat2,long2)
+//using only integer math (see trig.h)
+//  (NOTE: within 0.6m plus 0.002% of the exact haversine up to 10000km, and
+//   within 0.15% from there to the antipode, as measured on the build host)
+//  returns uint32_t - the distance in meters
+uint32_t get_distance_fixed(int32_t lat1, int32_t long1,
+                            int32_t lat2, int32_t long2);
+
+//calulates the forward azimuth given two points using only integer math
+//  (NOTE: within 1 degree of the exact azimuth, rounding included, when the
+//   points are more than 5m apart)
+//  returns int16_t - the azimuth in degrees, from -180 to 180
+int16_t get_fwd_azimuth_fixed(int32_t lat1, int32_t long1,
+                              int32_t lat2, int32_t long2);
+
+//calculates distance between two coordinates on the WGS84 ellipsoid
+//  (NOTE: Lambert's formula, within about 10m over thousands of kilometers,
+//   uses floats)
+//  returns uint32_t - the distance in meters
+uint32_t get_distance_ellipsoid(int32_t lat1, int32_t long1,
+                                int32_t lat2, int32_t long2);
+
+//sets how far the flat model is allowed to be from the haversine before the
+//haversine is used instead
+//  uint16_t meters - the error bound
+void dist_set_error_bound(uint16_t meters);
+
+//turns the ellipsoid model on or off
+//  uint8_t precise - 1 to always use the ellipsoid model, 0 for the cheapest
+//    good enough model
+void dist_set_precise(uint8_t precise);
+
+//returns uint8_t - 1 if the ellipsoid model is on, 0 otherwise
+uint8_t dist_get_precise();
+
+//works out everything about the destination that doesn't depend on where we
+//are, so it can be reused for every fix until the destination changes
+//  (NOTE: uses floats for the ellipsoid model's terms)
+//  dest_geom_t* dest - where to store it
+//  int32_t lat, lon - the destination
+void dest_geom_init(dest_geom_t* dest, int32_t lat, int32_t lon);
+
+//calculates distance and azimuth to the destination with the cheapest model
+//that meets the error bound, or with the ellipsoid if precision was asked for
+//  const dest_geom_t* dest - the destination (see dest_geom_init)
+//  int32_t lat, lon - where we are
+//  uint32_t* distance - where to store the distance in meters
+//  int16_t* azimuth - where to store the forward azimuth in degrees
+//  returns uint8_t - the DIST_MODEL_* that was used
+uint8_t get_dist_azimuth(const dest_geom_t* dest, int32_t lat, int32_t lon,
+                         uint32_t* distance, int16_t* azimuth);
 
 #endif
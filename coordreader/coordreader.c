@@ -2,28 +2,25 @@
 #include <inttypes.h>
 #include <endian.h>
 
-//used to directly convert ints to floats and floats to ints
-typedef union{
-  uint32_t i;
-  float f;
-}intfloat_t;
+//coordinates are stored as fixed point, in units of 1e-7 degrees
+#define COORD_PER_DEG 10000000L
 
 //read the next value in from the EEPROM dump
 //  FILE* file   - the file to read
-//  float* val   - where to write the value that was read
+//  double* val  - where to write the value that was read, in degrees
 //  returns char - 0 if the read failed, 1 if it succeeded
-char read_next_val(FILE* file, float* val){
+char read_next_val(FILE* file, double* val){
   char result = 0;
-  intfloat_t temp;
+  uint32_t temp;
 
   //read in 1 value from the file
   if( fread(&temp, sizeof(temp), 1, file) == 1 ){
     //we succeeded
     result = 1;
     //convert the AVR's little-endian encoding into whatever the host uses
-    temp.i = le32toh(temp.i);
-    //copy over the new value as a float
-    *val = temp.f;
+    temp = le32toh(temp);
+    //scale the fixed point value back into degrees
+    *val = ((int32_t)temp)/(double)COORD_PER_DEG;
   }
 
   return result;
@@ -33,8 +30,8 @@ int main(int argc, char** argv){
   FILE* eepromfile = NULL;
   FILE* csvfile = NULL;
   int current_slot = 0;
-  float current_lat = 0;
-  float current_long = 0;
+  double current_lat = 0;
+  double current_long = 0;
   char noerror = 1;
 
   //too few args?
@@ -66,9 +63,9 @@ int main(int argc, char** argv){
         while(noerror){
           noerror &= read_next_val(eepromfile, &current_lat);
           noerror &= read_next_val(eepromfile, &current_long);
-          fprintf(csvfile, "%d,%f,%f\n", current_slot,
-                                         current_lat,
-                                         current_long);
+          fprintf(csvfile, "%d,%.7f,%.7f\n", current_slot,
+                                             current_lat,
+                                             current_long);
           current_slot++;
         }
 
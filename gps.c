@@ -21,238 +21,909 @@ SOFTWARE.
 ***/
 
 #include <avr/io.h>
-#include <stdio.h> //for sprintf and NULL
-#include <stdlib.h> //for atof and such
-#include <string.h> //for cstring processing
+#include <avr/pgmspace.h> //for program space storage
+#include <util/delay.h>
+#include <stdlib.h> //for labs
+#include <string.h> //for strncmp and memcpy
 #include "gps.h"
 #include "uart.h"
+#include "nmea.h"
+#ifdef GPS_PROTOCOL_UBX
+#include "ubx.h"
+#endif
 #include "coord_dist.h"
+#include "navfilter.h"
+#include "trig.h" //for gps_predict
+#include "storage.h" //for remembering the baud rate
+#include "tick.h" //for timeouts
+
+//the baud rate we want the GPS at (exact at 7.3728MHz, see uart_init)
+static const unsigned long __GPS_BAUD = 115200;
+//the baud rates the GPS might be at when we start, most likely first
+static const uint32_t PROGMEM GPS_BAUDS[] = {
+  115200, 38400, 9600, 4800, 57600, 19200
+};
+#define GPS_NUM_BAUDS (sizeof(GPS_BAUDS)/sizeof(GPS_BAUDS[0]))
+//how long to listen at each baud rate, in milliseconds (the GPS sends at
+// least once a second)
+static const uint16_t __GPS_DETECT_TIME = 1500;
+//how many sentences (or UBX messages) with good checksums it takes to be sure
+//of a baud rate
+static const uint8_t __GPS_DETECT_LINES = 2;
+//how long the GPS takes to change its baud rate, in milliseconds
+static const uint16_t __GPS_BAUD_SWITCH_TIME = 100;
+//how far (in 1e-7 degrees, about 2m) the fix wanders while standing still,
+// moving less than this doesn't change the distance or azimuth
+static const int32_t __GPS_FIX_NOISE = 200;
+//how long to wait for the GPS to acknowledge a command, in milliseconds
+static const uint16_t __GPS_ACK_TIMEOUT = 1000;
+//how many times to send a command before giving up on it
+static const uint8_t __GPS_CMD_TRIES = 3;
+//how long after an update (in milliseconds) gps_predict keeps extrapolating
+// it, by then the next one is overdue and it's better to wait for it
+static const uint16_t __GPS_PREDICT_TIME = 2000/GPS_FIX_RATE;
+//centimeters per 1e-7 degrees of latitude, in 1/256ths (1.112cm)
+#define GPS_CM_PER_COORD 285
+
+#ifdef GPS_PROTOCOL_UBX
+//UBX messages, without the sync characters and checksum (they're added when
+//sending): class, ID, little-endian payload length, then the payload
+//  CFG-PRT - UART1 at 8N1 and __GPS_BAUD, taking UBX and NMEA in but only
+//    sending UBX
+static const uint8_t PROGMEM UBX_SET_PORT[] = {
+  UBX_CLASS_CFG, UBX_ID_CFG_PRT, 20, 0,
+  1, 0, 0x00, 0x00,           //port, reserved, no TX ready pin
+  0xD0, 0x08, 0x00, 0x00,     //8N1
+  0x00, 0xC2, 0x01, 0x00,     //115200
+  0x03, 0x00, 0x01, 0x00,     //in: UBX and NMEA, out: UBX
+  0x00, 0x00, 0x00, 0x00
+};
+//  CFG-MSG - send NAV-PVT every fix
+static const uint8_t PROGMEM UBX_SET_OUTPUT[] = {
+  UBX_CLASS_CFG, UBX_ID_CFG_MSG, 3, 0,
+  UBX_CLASS_NAV, UBX_ID_NAV_PVT, 1
+};
+//  CFG-RATE - milliseconds between fixes, one fix per measurement, GPS time
+static const uint8_t PROGMEM UBX_SET_RATE[] = {
+  UBX_CLASS_CFG, UBX_ID_CFG_RATE, 6, 0,
+  (1000/GPS_FIX_RATE) & 0xFF, (1000/GPS_FIX_RATE) >> 8, 1, 0, 1, 0
+};
+#else
+//MTK commands, without the "$" and checksum (they're added when sending)
+//  PMTK314 - sentence rates in fixes per sentence: GLL, RMC, VTG, GGA, GSA,
+//    GSV, then 13 sentences we never want (GSV is long and only drawn once
+//    a second, so at higher fix rates it's only sent every 5th fix, the
+//    most the GPS allows)
+//  PMTK251 - baud rate (has to match __GPS_BAUD)
+static const char PROGMEM PMTK_SET_BAUD[] = "PMTK251,115200";
+//  PMTK220 - milliseconds between fixes
+#if GPS_FIX_RATE == 10
+static const char PROGMEM PMTK_SET_OUTPUT[] =
+  "PMTK314,0,1,1,1,1,5,0,0,0,0,0,0,0,0,0,0,0,0,0";
+static const char PROGMEM PMTK_SET_RATE[] = "PMTK220,100";
+#elif GPS_FIX_RATE == 5
+static const char PROGMEM PMTK_SET_OUTPUT[] =
+  "PMTK314,0,1,1,1,1,5,0,0,0,0,0,0,0,0,0,0,0,0,0";
+static const char PROGMEM PMTK_SET_RATE[] = "PMTK220,200";
+#else
+static const char PROGMEM PMTK_SET_OUTPUT[] =
+  "PMTK314,0,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0";
+static const char PROGMEM PMTK_SET_RATE[] = "PMTK220,1000";
+#endif
+//  PMTK001 - the acknowledgement, with the command and a flag
+#define PMTK_ACK_DONE 3 //the flag for "valid command, carried out"
+#endif
+
+//assembles sentences as the bytes come in from the UART
+static nmea_parser_t gps_parser;
+//where the fields of the current sentence start
+static nmea_fields_t gps_fields;
+#ifdef GPS_PROTOCOL_UBX
+//assembles UBX messages as the bytes come in
+static ubx_parser_t gps_ubx;
+#else
+//the types of sentence gps_poll keeps, in the same order as the GPS_GGA etc.
+// bits (whichever talker they're from, e.g. "$GPGGA" or "$GNGGA")
+static const char PROGMEM GPS_TYPES[] = "GGA" "GSA" "RMC" "VTG" "GSV";
+#define GPS_NUM_TYPES 5
+//the ones with a time in them
+#define GPS_TIMED (GPS_GGA|GPS_RMC)
+
+//the update being assembled, it only goes into the caller's loc_state_t
+// once every sentence of it has arrived
+static loc_state_t gps_epoch;
+//the time of the update being assembled, as hhmmss.sss in milliseconds
+static int32_t gps_epoch_stamp;
+//which sentences (GPS_GGA etc.) of it have arrived since it started or was
+// handed over, 0 if none have
+static uint8_t gps_epoch_have = 0;
+//1 once there's been a time, so sentences without one have something to go
+// with (this stays set after an update is handed over, since the GPS can
+// send some of them, like GSV, after the rest)
+static uint8_t gps_epoch_live = 0;
+
+//the satellites in view are assembled from a sequence of GSV sentences (one
+// per talker for multi-constellation GPSes), and only shown once a whole
+// sequence is in
+static gps_sat_t gps_sky_stage[GPS_MAX_SATS];
+static uint8_t gps_sky_staged = 0;
+//how many were staged before the current sequence started, for throwing it
+// away if a sentence of it goes missing
+static uint8_t gps_sky_base = 0;
+//the number of the next sentence of the sequence, 0 if there isn't one
+static uint8_t gps_sky_next = 0;
+#endif
+//the last complete set of satellites in view
+static gps_sat_t gps_sky[GPS_MAX_SATS];
+static uint8_t gps_sky_count = 0;
+
+//fields of the last update that only some pages show, they're decoded the
+// first time they're asked for
+#define GPS_LAZY_DOP      0x01
+#define GPS_LAZY_ALTITUDE 0x02
+#define GPS_LAZY_SPEED    0x04
+static int gps_dop; //PDOP
+static int32_t gps_altitude; //in centimeters
+static int32_t gps_speed; //in centimeters per second
+//which of them (GPS_LAZY_*) have been decoded
+static uint8_t gps_decoded = 0;
+#ifndef GPS_PROTOCOL_UBX
+//...until then, they're kept as text (the longest is an altitude like
+// "-1234.5")
+#define GPS_RAW_LEN 10
+struct gps_raw {
+  char dop[GPS_RAW_LEN];
+  char altitude[GPS_RAW_LEN];
+  char speed[GPS_RAW_LEN]; //in km/h
+};
+//the text of the update being assembled, and of the last complete one
+static struct gps_raw gps_raw_stage;
+static struct gps_raw gps_raw;
+#endif
+
+//the destination's half of the math, worked out when it changes
+static dest_geom_t gps_dest;
+//where we were the last time the distance and azimuth were worked out
+static int32_t gps_calc_lat, gps_calc_long;
+static uint32_t gps_distance;
+static int16_t gps_azimuth;
+//smooths the position and heading, and coasts when the fix drops out
+static navfilter_t gps_nav;
+
+#ifdef GPS_PROTOCOL_UBX
+//parses a NAV-PVT message
+//  const ubx_parser_t* p - the message
+//  loc_state_t* loc - where to store location data
+void parseNAVPVT( const ubx_parser_t* p, loc_state_t* loc ){
+  //get the time, as hhmmss like the NMEA sentences have it
+  (loc->time) = p->payload[8]*10000UL + p->payload[9]*100 + p->payload[10];
+
+  //the rest is only good if there is a fix (bit 0 of the flags)
+  (loc->fix) = p->payload[21] & 0x01;
+  if( !(loc->fix) ){
+    return;
+  }
+
+  //coordinates are already in units of 1e-7 degrees, longitude first
+  (loc->curr_long) = ubx_i32(p, 24);
+  (loc->curr_lat) = ubx_i32(p, 28);
+
+  //get the number of satellites
+  (loc->sats) = p->payload[23];
+
+  //get the altitude above mean sea level (in millimeters, kept in
+  // centimeters)
+  gps_altitude = ubx_i32(p, 36)/10;
 
-static const char* __GPS_DELIM = ",";
+  //get the ground speed (in millimeters per second, kept in centimeters per
+  // second)
+  gps_speed = ubx_i32(p, 60)/10;
 
-static const unsigned long __GPS_BAUD = 38400;
-static const uint8_t __GPS_ECHO_OFF = 0;
+  //get the heading of motion, in units of 1e-5 degrees
+  (loc->heading) = ubx_i32(p, 64)/100000;
 
-static const uint8_t __GPS_LARGE_BUF_LEN = 80;
+  //get the position dilution of precision (PDOP, the same one the NMEA
+  // protocol takes from GSA), in units of 0.01
+  gps_dop = ubx_u16(p, 76)/100;
 
-//converts an ASCII character to an integer
-static inline int ascii_to_dec(char ch){
-  return ch-0x30;
+  //(decoding these is no work, so they're never left for later)
+  gps_decoded = GPS_LAZY_DOP | GPS_LAZY_ALTITUDE | GPS_LAZY_SPEED;
 }
+#else
+//parses a GGA sentence (from any talker)
+//  const nmea_fields_t* f - the tokenized sentence
+//  loc_state_t* loc - where to store location data
+void parseGGA( const nmea_fields_t* f, loc_state_t* loc ){
+  //get the time (the fraction of a second is dropped)
+  loc->time = nmea_parse_int( nmea_field(f, 1) ); //+TIME_OFFSET;
+
+  //get the latitude
+  loc->curr_lat = nmea_parse_dm( nmea_field(f, 2) );
+  // if it's South, then negate the latitude
+  if( nmea_field(f, 3)[0] == 'S' ){
+    (loc->curr_lat) = -(loc->curr_lat);
+  }
 
-//parses an 8 digit GPS coordinate
-static float parse_8digit(char* pch){
-  float result;
+  //get the longitude
+  loc->curr_long = nmea_parse_dm( nmea_field(f, 4) );
+  // if it's West, then negate the longitude
+  if( nmea_field(f, 5)[0] == 'W' ){
+    (loc->curr_long) = -(loc->curr_long);
+  }
 
-  // it'll look like: 1234.5678
-  // where 34.5678 is the number of minutes and 12 is the latitude
+  //get the fix quality (the type of fix, 0 if there isn't one)
+  (loc->fix) = ( nmea_parse_int( nmea_field(f, 6) ) != 0 );
 
-  // we only want the first two characters initially
-  result = ascii_to_dec(pch[0])*10;
-  result += ascii_to_dec(pch[1]);
-  pch += 2;
-  //now, get the remaining numbers and convert from
-  // minutes to a fraction
-  result += atof( pch )/60;
+  //get the number of satellites
+  (loc->sats) = nmea_parse_int( nmea_field(f, 7) );
 
-  return result;
+  //field 8 is the horizontal dilution of precision (HDOP), but the position
+  // one from GSA is shown instead, the same as with UBX
+
+  //get the altitude (decoded later, see gps_get_altitude)
+  nmea_copy_field( nmea_field(f, 9), gps_raw_stage.altitude, GPS_RAW_LEN );
 }
 
-//parses a 9 digit GPS coordinate
-static float parse_9digit(char* pch){
-  float result;
+//parses a RMC sentence (from any talker)
+//  const nmea_fields_t* f - the tokenized sentence
+//  loc_state_t* loc - where to store location data
+void parseRMC( const nmea_fields_t* f, loc_state_t* loc ){
+  //field 1 is the time
+
+  //get the status
+  (loc->fix) = ( nmea_field(f, 2)[0] == 'A' );
+  if( loc->fix ){ //if the status is "Active"...
+    //fields 3 to 6 are the position, 7 is the speed in knots
+
+    //get track angle in degrees True
+    (loc->heading) = nmea_parse_int( nmea_field(f, 8) );
 
-  // it'll look like: 01234.5678
-  // where 34.5678 is the number of minutes and 012 is the longitude
+    //field 9 is the date
+  }
+} //end RMC parse
 
-  //get the first digit
-  result = ascii_to_dec(pch[0])*100;
-  //then, parse the rest as an 8 digit
-  pch++;
-  result += parse_8digit(pch);
+//parses a GSA sentence (from any talker)
+//  const nmea_fields_t* f - the tokenized sentence
+//  loc_state_t* loc - where to store location data
+void parseGSA( const nmea_fields_t* f, loc_state_t* loc ){
+  //fields 1 and 2 are the mode, 3 to 14 are the satellites used
 
-  return result;
-}
+  // get the position dilution of precision (PDOP, 16 and 17 are the
+  // horizontal and vertical ones)
+  // (decoded later, see gps_get_dop)
+  nmea_copy_field( nmea_field(f, 15), gps_raw_stage.dop, GPS_RAW_LEN );
+} //end GSA parse
 
-//parses a GPGGA line
-//  char* gpgga_line - a NULL-terminated string
+//parses a VTG sentence (from any talker)
+//  const nmea_fields_t* f - the tokenized sentence
 //  loc_state_t* loc - where to store location data
-void parseGPGGA( char* gpgga_line, loc_state_t* loc ){
-  char* pch;
-
-  //initialize our tokenizer (and discard the first token)
-  pch = strtok( gpgga_line, __GPS_DELIM );
-
-  //get the time:
-  pch = strtok( NULL, __GPS_DELIM );
-  // convert the cstring to an unsigned long and use the time offset
-  loc->time = atol( pch ); //+TIME_OFFSET;
-
-  //get the next token (the latitude)
-  pch = strtok( NULL, __GPS_DELIM );
-  loc->curr_lat = parse_8digit(pch);
-  //get the next token (North/South latitude)
-  pch = strtok( NULL, __GPS_DELIM );
-  // if it's South, then negate the latitude
-  if( pch[0]=='S' ){
-    (loc->curr_lat) = -(loc->curr_lat);
+void parseVTG( const nmea_fields_t* f, loc_state_t* loc ){
+  //fields 1 to 6 are the tracks and the speed in knots
+
+  // get the speed in km/h (decoded later, see gps_get_speed)
+  nmea_copy_field( nmea_field(f, 7), gps_raw_stage.speed, GPS_RAW_LEN );
+}
+
+//parses a GSV sentence (from any talker), which has up to 4 of the
+//satellites in view
+//  const nmea_fields_t* f - the tokenized sentence
+//  loc_state_t* loc - not used, satellites don't go in the location state
+void parseGSV( const nmea_fields_t* f, loc_state_t* loc ){
+  uint8_t total = nmea_parse_int( nmea_field(f, 1) );
+  uint8_t num = nmea_parse_int( nmea_field(f, 2) );
+  gps_sat_t* sat;
+  uint8_t i;
+
+  //field 3 is the number of satellites in view
+
+  //the first sentence starts a sequence, the rest have to follow in order
+  if( num == 1 ){
+    gps_sky_base = gps_sky_staged;
+    gps_sky_next = 1;
+  } else if( num != gps_sky_next ){
+    //one went missing, so throw away what we have of this sequence
+    if( gps_sky_next != 0 ){
+      gps_sky_staged = gps_sky_base;
+      gps_sky_next = 0;
+    }
+    return;
   }
 
-  //get the next token (the longitude)
-  pch = strtok( NULL, __GPS_DELIM );
-  loc->curr_long = parse_9digit(pch);
-  //get the next token (East/West longitude)
-  pch = strtok( NULL, __GPS_DELIM );
-  // if it's West, then negate the longitude
-  if( pch[0]=='W' ){
-    (loc->curr_long) = -(loc->curr_long);
+  //each satellite is 4 fields: PRN, elevation, azimuth, SNR
+  for( i = 4; (i+3 < f->count) && (gps_sky_staged < GPS_MAX_SATS); i += 4 ){
+    if( nmea_field_empty( nmea_field(f, i) ) ){
+      continue;
+    }
+    sat = &gps_sky_stage[gps_sky_staged];
+    sat->prn = nmea_parse_int( nmea_field(f, i) );
+    sat->elevation = nmea_parse_int( nmea_field(f, i+1) );
+    sat->azimuth = ( nmea_parse_int(nmea_field(f, i+2)) + 1 )/2;
+    sat->snr = nmea_parse_int( nmea_field(f, i+3) ); //empty if not tracked
+    gps_sky_staged++;
   }
+  gps_sky_next++;
 
-  //get the next token (GPS link type)
-  pch = strtok( NULL, __GPS_DELIM );
+  //if that was the last one, everything staged so far gets shown
+  if( num == total ){
+    memcpy( gps_sky, gps_sky_stage, gps_sky_staged*sizeof(gps_sat_t) );
+    gps_sky_count = gps_sky_staged;
+    gps_sky_next = 0;
+  }
+}
 
-  //get the next token (number of satellites)
-  pch = strtok( NULL, __GPS_DELIM );
-  (loc->sats) = atoi( pch );
+//what parses each of GPS_TYPES
+//  (NOTE: read it with pgm_read_word, pointers are 16 bits)
+typedef void (*gps_parse_fn)( const nmea_fields_t* f, loc_state_t* loc );
+static const gps_parse_fn PROGMEM GPS_PARSERS[GPS_NUM_TYPES] = {
+  parseGGA, parseGSA, parseRMC, parseVTG, parseGSV
+};
+#endif
+
+#ifdef GPS_PROTOCOL_UBX
+//sends a UBX message to the GPS
+//  const uint8_t* PROGMEM msg - the class, ID, length and payload
+static void gps_send_ubx_p( const uint8_t* PROGMEM msg ){
+  uint16_t len = 4 + ( pgm_read_byte_near(msg+2) |
+                       (pgm_read_byte_near(msg+3) << 8) );
+  uint8_t ck_a = 0;
+  uint8_t ck_b = 0;
+  uint8_t c;
+
+  uart_send(UBX_SYNC_CHAR1);
+  uart_send(UBX_SYNC_CHAR2);
+  //work out the checksum while sending
+  while( len > 0 ){
+    c = pgm_read_byte_near(msg);
+    uart_send(c);
+    ck_a += c;
+    ck_b += ck_a;
+    msg++;
+    len--;
+  }
+  uart_send(ck_a);
+  uart_send(ck_b);
+}
 
-  //get the next token (horizontal accuracy)
-  pch = strtok( NULL, __GPS_DELIM );
+//waits for the GPS to acknowledge a UBX message
+//  (NOTE: other messages coming in meanwhile are thrown away)
+//  uint8_t msg_class, msg_id - the message that was sent
+//  returns uint8_t - 1 if it was acknowledged, 0 if it was refused or never
+//    acknowledged
+static uint8_t gps_wait_ubx_ack( uint8_t msg_class, uint8_t msg_id ){
+  tick_timer_t timeout;
+  char ch;
+
+  tick_timer_start(&timeout, __GPS_ACK_TIMEOUT);
+  while( !tick_timer_expired(&timeout) ){
+    if( uart_poll(&ch) && ubx_feed(&gps_ubx, ch) &&
+        (gps_ubx.msg_class == UBX_CLASS_ACK) &&
+        (gps_ubx.len == 2) &&
+        (gps_ubx.payload[0] == msg_class) &&
+        (gps_ubx.payload[1] == msg_id) ){
+      return gps_ubx.msg_id == UBX_ID_ACK_ACK;
+    }
+  }
 
-  //get the next token (altitude)
-  pch = strtok( NULL, __GPS_DELIM );
-  (loc->altitude) = atof( pch );
+  return 0;
 }
 
-//parses a GPRMC line
-//  char* gprmc_line - a NULL-terminated string
-//  loc_state_t* loc - where to store location data
-void parseGPRMC( char* gprmc_line, loc_state_t* loc ){
-  char* pch;
+//sends a UBX message until the GPS acknowledges it
+//  const uint8_t* PROGMEM msg - the class, ID, length and payload
+//  returns uint8_t - 1 if the message was acknowledged, 0 otherwise
+static uint8_t gps_command_p( const uint8_t* PROGMEM msg ){
+  uint8_t tries;
+
+  for( tries = 0; tries < __GPS_CMD_TRIES; tries++ ){
+    gps_send_ubx_p(msg);
+    if( gps_wait_ubx_ack(pgm_read_byte_near(msg),
+                         pgm_read_byte_near(msg+1)) ){
+      return 1;
+    }
+  }
 
-  //initialize our tokenizer (and discard the first token)
-  pch = strtok( gprmc_line, __GPS_DELIM );
+  return 0;
+}
+#else
+//sends an MTK command to the GPS
+//  const char* PROGMEM cmd - the command, without the "$" and checksum
+static void gps_send_cmd_p( const char* PROGMEM cmd ){
+  uint8_t sum = 0;
+  char c = pgm_read_byte_near(cmd);
+
+  uart_send('$');
+  //work out the checksum while sending
+  while( c != '\0' ){
+    uart_send(c);
+    sum ^= c;
+    cmd++;
+    c = pgm_read_byte_near(cmd);
+  }
+  uart_send('*');
+  uart_print8(sum);
+  uart_send('\r');
+  uart_send('\n');
+}
 
-  //get the time
-  pch = strtok( NULL, __GPS_DELIM );
+//waits for the GPS to acknowledge an MTK command
+//  (NOTE: other sentences coming in meanwhile are thrown away)
+//  uint16_t cmd - the number of the command, e.g. 314 for PMTK314
+//  returns uint8_t - 1 if the command was carried out, 0 if it was refused
+//    or never acknowledged
+static uint8_t gps_wait_ack( uint16_t cmd ){
+  tick_timer_t timeout;
+  char ch;
+
+  tick_timer_start(&timeout, __GPS_ACK_TIMEOUT);
+  while( !tick_timer_expired(&timeout) ){
+    if( uart_poll(&ch) && nmea_feed(&gps_parser, ch) &&
+        (strncmp(gps_parser.buf, "$PMTK001,", 9) == 0) ){
+      nmea_tokenize( gps_parser.buf, &gps_fields );
+
+      if( nmea_parse_int(nmea_field(&gps_fields, 1)) == cmd ){
+        return nmea_parse_int(nmea_field(&gps_fields, 2)) == PMTK_ACK_DONE;
+      }
+    }
+  }
 
-  //get the status
-  pch = strtok( NULL, __GPS_DELIM );
-  if( pch[0] == 'A' ){ //if the status is "Active"...
-    //get latitude
-    pch = strtok( NULL, __GPS_DELIM );
-    pch = strtok( NULL, __GPS_DELIM ); //north or south
+  return 0;
+}
 
-    //get latitude
-    pch = strtok( NULL, __GPS_DELIM );
-    pch = strtok( NULL, __GPS_DELIM ); //east or west
+//sends an MTK command until the GPS acknowledges it
+//  const char* PROGMEM cmd - the command, without the "$" and checksum
+//  uint16_t num - the number of the command, e.g. 314 for PMTK314
+//  returns uint8_t - 1 if the command was carried out, 0 otherwise
+static uint8_t gps_command_p( const char* PROGMEM cmd, uint16_t num ){
+  uint8_t tries;
+
+  for( tries = 0; tries < __GPS_CMD_TRIES; tries++ ){
+    gps_send_cmd_p(cmd);
+    if( gps_wait_ack(num) ){
+      return 1;
+    }
+  }
 
-    //get speed in knots
-    pch = strtok( NULL, __GPS_DELIM );
+  return 0;
+}
+#endif
+
+//feeds a received byte to whichever parsers are listening for the GPS
+//  char ch - the byte
+//  returns uint8_t - 1 if it finished a sentence or message with a good
+//    checksum, 0 otherwise
+static uint8_t gps_feed( char ch ){
+#ifdef GPS_PROTOCOL_UBX
+  //the GPS might already be sending UBX from the last time we set it up
+  if( ubx_feed(&gps_ubx, ch) ){
+    return 1;
+  }
+#endif
 
-    //get track angle in degrees True
-    pch = strtok( NULL, __GPS_DELIM );
-    (loc->heading) = atoi( pch );
+  return nmea_feed(&gps_parser, ch);
+}
 
-    //get the date
-    //pch = strtok( line, NULL );
+//checks if the GPS is sending at the baud rate the UART is set to
+//  returns uint8_t - 1 if enough good sentences came in, 0 otherwise
+static uint8_t gps_listen(){
+  tick_timer_t timeout;
+  uint8_t good = 0;
+  char ch;
+
+  //at the wrong baud rate, sentences come in garbled, and the checksums
+  // won't match
+  nmea_init(&gps_parser);
+#ifdef GPS_PROTOCOL_UBX
+  ubx_init(&gps_ubx);
+#endif
+  tick_timer_start(&timeout, __GPS_DETECT_TIME);
+  while( (good < __GPS_DETECT_LINES) && !tick_timer_expired(&timeout) ){
+    if( uart_poll(&ch) && gps_feed(ch) ){
+      good++;
+    }
   }
-} //end GPRMC parse
 
-//parses a GPGSA line
-//  char* gpgsa_line - a NULL-terminated string
-//  loc_state_t* loc - where to store location data
-void parseGPGSA( char* gpgsa_line, loc_state_t* loc ){
-  uint8_t i=0;
-  char* pch;
+  return good >= __GPS_DETECT_LINES;
+}
 
-  //initialize our tokenizer (and discard the first token)
-  pch = strtok( gpgsa_line, __GPS_DELIM );
+//finds the baud rate the GPS is at, and sets the UART to it
+//  uint32_t last - the baud rate the GPS was at last time, tried first
+//  returns uint32_t - the baud rate, 0 if the GPS couldn't be heard
+static uint32_t gps_detect_baud( uint32_t last ){
+  uint32_t baud;
+  uint8_t i;
+
+  //try last time's baud rate first, but only if it's one we know (the
+  // EEPROM is blank the very first time)
+  for( i = 0; i < GPS_NUM_BAUDS; i++ ){
+    if( pgm_read_dword_near(&GPS_BAUDS[i]) == last ){
+      uart_init(last);
+      if( gps_listen() ){
+        return last;
+      }
+    }
+  }
 
-  //skip a bunch of tokens and lastly get the PDOP token
-  for(i=0; i<13; i++){
-    pch = strtok( NULL, __GPS_DELIM );
+  //...then all the others
+  for( i = 0; i < GPS_NUM_BAUDS; i++ ){
+    baud = pgm_read_dword_near(&GPS_BAUDS[i]);
+    if( baud != last ){
+      uart_init(baud);
+      if( gps_listen() ){
+        return baud;
+      }
+    }
   }
 
-  // get dilution of precision
-  (loc->dop) = atof( pch );
-} //end GPGSA parse
+  return 0;
+}
 
-//parses a GPVTG line
-//  char* gpvtg_line - a NULL-terminated string
-//  loc_state_t* loc - where to store location data
-void parseGPVTG( char* gpvtg_line, loc_state_t* loc ){
-  uint8_t i=0;
-  char* pch;
+//moves the GPS to __GPS_BAUD, and the UART with it
+//  (NOTE: there's no acknowledgement, the GPS switches as soon as it gets
+//   the command)
+//  uint32_t baud - the baud rate the GPS is at now
+//  returns uint32_t - the baud rate it ended up at
+static uint32_t gps_set_baud( uint32_t baud ){
+#ifdef GPS_PROTOCOL_UBX
+  gps_send_ubx_p(UBX_SET_PORT);
+#else
+  gps_send_cmd_p(PMTK_SET_BAUD);
+#endif
+  //(the last bytes are still being sent when uart_send returns)
+  _delay_ms(__GPS_BAUD_SWITCH_TIME);
+  uart_init(__GPS_BAUD);
 
-  //initialize our tokenizer (and discard the first token)
-  pch = strtok( gpvtg_line, __GPS_DELIM );
+  if( gps_listen() ){
+    return __GPS_BAUD;
+  }
+
+  //it didn't take, stay where it was
+  uart_init(baud);
+  return baud;
+}
 
-  //skip a bunch of tokens and lastly get the speed in km/h token
-  for(i=0; i<6; i++){
-    pch = strtok( NULL, __GPS_DELIM );
+//initializes the GPS, and sets it up to send only the sentences we use
+//  (NOTE: interrupts and the tick need to be on, since this waits for the GPS
+//   to reply)
+//  returns uint8_t - 1 if the GPS took every setting, 0 otherwise
+uint8_t gps_init(){
+  uint32_t last = get_gps_baud();
+  uint32_t baud;
+  uint8_t result = 0;
+
+  nmea_init(&gps_parser);
+
+  //fire up the serial port at whatever rate the GPS is at
+  baud = gps_detect_baud(last);
+  if( baud == 0 ){
+    //nothing heard, it may still turn up at the rate we want
+    uart_init(__GPS_BAUD);
+  } else {
+    //speed it up if it isn't already
+#ifdef GPS_PROTOCOL_UBX
+    //(the port settings are also what turn UBX output on, so always send
+    // them)
+    baud = gps_set_baud(baud);
+#else
+    if( baud != __GPS_BAUD ){
+      baud = gps_set_baud(baud);
+    }
+#endif
+
+    //remember it so the next start doesn't have to look for it
+    if( baud != last ){
+      store_gps_baud(baud);
+    }
+
+    //stop the sentences we'd only throw away, and set the fix rate
+#ifdef GPS_PROTOCOL_UBX
+    result = gps_command_p(UBX_SET_OUTPUT);
+    result &= gps_command_p(UBX_SET_RATE);
+#else
+    result = gps_command_p(PMTK_SET_OUTPUT, 314);
+    result &= gps_command_p(PMTK_SET_RATE, 220);
+#endif
   }
 
-  // get dilution of precision
-  (loc->speed) = atof( pch );
+  //the filter starts over from the first fix
+  navfilter_init(&gps_nav);
+
+  //whatever was half received while waiting is no good to gps_poll
+#ifdef GPS_PROTOCOL_UBX
+  ubx_init(&gps_ubx);
+#else
+  nmea_init(&gps_parser);
+  //...which only wants the sentences it parses
+  nmea_set_types(&gps_parser, GPS_TYPES, GPS_NUM_TYPES);
+#endif
+
+  return result;
 }
 
-//initializes the GPS
-void gps_init(){
-  //fire up the serial port
-  uart_init(__GPS_BAUD);
+//sets the destination
+//  loc_state_t* loc - the location state to update
+//  int32_t lat, lon - the destination, in units of 1e-7 degrees
+void gps_set_dest( loc_state_t* loc, int32_t lat, int32_t lon ){
+  (loc->dest_lat) = lat;
+  (loc->dest_long) = lon;
+  //the next update works out the new destination's half of the math
+  (loc->dest_changed) = 1;
 }
 
-//get updated GPS data
-//  (NOTE: this function waits until the final line of data has been sent by
-//   the GPS)
+//works out how far off our heading the destination is
+//  loc_state_t* loc - the location state to update
+//  int16_t azimuth - the azimuth to the destination, in degrees
+static void gps_calc_delta( loc_state_t* loc, int16_t azimuth ){
+  loc->deltaHeading = azimuth-loc->heading;
+
+  //if the "left turn" is too big, make it a "right turn" (and the other way
+  // around, for extrapolated azimuths just past 180)
+  if( loc->deltaHeading < -180 ){
+    loc->deltaHeading = loc->deltaHeading+360;
+  } else if( loc->deltaHeading > 180 ){
+    loc->deltaHeading = loc->deltaHeading-360;
+  }
+}
+
+//calculates the distance and heading to the destination
+//  loc_state_t* loc - the location state to update
+static void gps_calc_dest( loc_state_t* loc ){
+  int32_t dlat = loc->curr_lat - gps_calc_lat;
+  int32_t dlong = coord_delta_long(gps_calc_long, loc->curr_long);
+  uint8_t precise = (loc->dist_model == DIST_MODEL_ELLIPSOID);
+
+  if( loc->dest_changed ){
+    dest_geom_init(&gps_dest, loc->dest_lat, loc->dest_long);
+  }
+
+  //if we haven't moved further than the fix wanders, and nothing else
+  // changed, the last distance and azimuth are still good
+  if( loc->dest_changed || (precise != dist_get_precise()) ||
+      (dlat >= __GPS_FIX_NOISE) || (dlat <= -__GPS_FIX_NOISE) ||
+      (dlong >= __GPS_FIX_NOISE) || (dlong <= -__GPS_FIX_NOISE) ){
+    //calculate the distance and the heading to the destination, with
+    // whatever model is good enough for how far away it is
+    loc->dist_model = get_dist_azimuth(&gps_dest,
+                                       loc->curr_lat, loc->curr_long,
+                                       &gps_distance, &gps_azimuth);
+    gps_calc_lat = loc->curr_lat;
+    gps_calc_long = loc->curr_long;
+    loc->dest_changed = 0;
+  }
+
+  //(gps_predict may have changed it since)
+  loc->distance = gps_distance;
+
+  //...and how far off our heading that is (the heading changes even when
+  // we don't move)
+  gps_calc_delta( loc, gps_azimuth );
+}
+
+//parses whatever received data is waiting, without blocking
 //  loc_state_t* loc - where to store GPS data
-void gps_update( loc_state_t* loc ){
-  char last_line = 0;
-  char line[__GPS_LARGE_BUF_LEN];
-  char gpgga_line[__GPS_LARGE_BUF_LEN];
-  char gpgsa_line[__GPS_LARGE_BUF_LEN];
-  char gprmc_line[__GPS_LARGE_BUF_LEN];
-  char gpvtg_line[__GPS_LARGE_BUF_LEN];
-
-  while( !last_line ){
-    //get a line
-    uart_getln(line, __GPS_LARGE_BUF_LEN, __GPS_ECHO_OFF);
-
-    //check if it's the uber line that has lots of neato things
-    if( strstr(line, "$GPGGA") != NULL ){
-      strcpy( gpgga_line, line );
+//  returns uint8_t - 1 if the final line of an update was parsed, 0 otherwise
+#ifdef GPS_PROTOCOL_UBX
+uint8_t gps_poll( loc_state_t* loc ){
+  uint8_t last_line = 0;
+  char ch;
+
+  //NAV-PVT has everything in it, so each one is a whole update
+  while( !last_line && uart_poll(&ch) ){
+    if( ubx_feed(&gps_ubx, ch) &&
+        ubx_is(&gps_ubx, UBX_CLASS_NAV, UBX_ID_NAV_PVT) &&
+        (gps_ubx.len == UBX_NAV_PVT_LEN) ){
+      parseNAVPVT( &gps_ubx, loc );
+      navfilter_update( &gps_nav, loc );
+      gps_calc_dest( loc );
+
+      last_line = 1; //break out of the loop
     }
-    //check if it's the uber line that has lots of neato things
-    if( strstr(line, "$GPGSA") != NULL ){
-      strcpy( gpgsa_line, line );
+  }
+
+  return last_line;
+}
+#else
+//starts a new update if a sentence's time isn't the one being assembled
+//  (NOTE: whatever was assembled of the last update is dropped if it wasn't
+//   complete)
+//  const nmea_fields_t* f - a sentence with the time in field 1
+static void gps_epoch_time( const nmea_fields_t* f ){
+  int32_t stamp = nmea_parse_fixed( nmea_field(f, 1), 3 );
+
+  if( !gps_epoch_live || (stamp != gps_epoch_stamp) ){
+    gps_epoch_stamp = stamp;
+    gps_epoch_have = 0;
+    gps_epoch_live = 1;
+    //...and a new set of satellites in view
+    gps_sky_staged = 0;
+    gps_sky_next = 0;
+  }
+}
+
+//hands a complete update to the caller
+//  loc_state_t* loc - where to store GPS data
+static void gps_epoch_commit( loc_state_t* loc ){
+  (loc->time) = gps_epoch.time;
+  (loc->curr_lat) = gps_epoch.curr_lat;
+  (loc->curr_long) = gps_epoch.curr_long;
+  (loc->heading) = gps_epoch.heading;
+  (loc->sats) = gps_epoch.sats;
+  (loc->fix) = gps_epoch.fix;
+  //the rest is decoded when it's asked for
+  memcpy( &gps_raw, &gps_raw_stage, sizeof(gps_raw) );
+  gps_decoded = 0;
+
+  //start over with the next one (sentences without a time that come after
+  // this still go with it, until a new time starts the next one)
+  gps_epoch_have = 0;
+}
+
+uint8_t gps_poll( loc_state_t* loc ){
+  uint8_t last_line = 0;
+  char* line = gps_parser.buf;
+  uint8_t got;
+  char ch;
+
+  //stop at the end of an update so the caller sees every one of them
+  while( !last_line && uart_poll(&ch) ){
+    //(only the types that were asked for should get through, but a type
+    // that isn't in the table must never be shifted or called)
+    if( !nmea_feed(&gps_parser, ch) || (gps_parser.type >= GPS_NUM_TYPES) ){
+      continue;
+    }
+
+    nmea_tokenize( line, &gps_fields );
+    got = 1 << gps_parser.type;
+
+    //sentences with a time in them start an update, or add to the one with
+    // the same time...
+    if( got & GPS_TIMED ){
+      gps_epoch_time( &gps_fields );
     }
-    //if this line is the one with position, velocity, and time
-    if( strstr(line, "$GPRMC") != NULL ){
-      strcpy( gprmc_line, line );
+    //...the ones without go with the last one that had it, but only if
+    // there was one (otherwise they could be left over from before)
+    else if( !gps_epoch_live ){
+      continue;
     }
-    //if this line is the one with speed
-    if( strstr(line, "$GPVTG") != NULL ){
-      strcpy( gpvtg_line, line );
-
-      //now that we've seen the last line we care about, begin calc
-      parseGPGGA( gpgga_line, loc );
-      parseGPGSA( gpgsa_line, loc );
-      parseGPRMC( gprmc_line, loc );
-      parseGPVTG( gpvtg_line, loc );
-
-      //finally, calculate the distance
-      loc->distance = get_distance(loc->curr_lat, loc->curr_long,
-                                   loc->dest_lat, loc->dest_long);
-      //...and the heading
-      loc->deltaHeading = get_fwd_azimuth(loc->curr_lat, loc->curr_long,
-                                          loc->dest_lat, loc->dest_long)-loc->heading;
-
-      //if the "left turn" is too big, make it a "right turn"
-      if( loc->deltaHeading < -180 ){
-        loc->deltaHeading = loc->deltaHeading+360;
-      }
+
+    ( (gps_parse_fn)pgm_read_word(&GPS_PARSERS[gps_parser.type]) )(
+      &gps_fields, &gps_epoch );
+    gps_epoch_have |= got;
+
+    //as soon as everything for this time is in, begin calc (whatever order
+    // it came in)
+    if( (gps_epoch_have & GPS_REQUIRED_SENTENCES) ==
+        GPS_REQUIRED_SENTENCES ){
+      gps_epoch_commit( loc );
+      navfilter_update( &gps_nav, loc );
+      gps_calc_dest( loc );
 
       last_line = 1; //break out of the loop
     }
   }
+
+  return last_line;
+}
+#endif
+
+//extrapolates the last update to now with the velocity the filter found, so
+//the display can change smoothly between updates
+//  (NOTE: there are no loops and only one long divide, so it's cheap enough
+//   to run between sentences, and the next update replaces everything it
+//   changes)
+//  loc_state_t* loc - the last update from gps_poll
+//  uint32_t ms - how long it's been since that update, in milliseconds
+void gps_predict( loc_state_t* loc, uint32_t ms ){
+  int32_t cos_lat, dlat, dlong, north, east, along, across;
+  angle_t dir;
+
+  //without a fix (or the new destination's math) there's nothing to go on,
+  // and an overdue update is better waited for
+  if( (loc->nav == NAV_NONE) || loc->dest_changed ||
+      (ms > __GPS_PREDICT_TIME) ){
+    return;
+  }
+
+  //how far we've gone since the update, in units of 1e-7 degrees (cm/s
+  // times ms is 1/1000ths of a centimeter)
+  dlat = ( (int32_t)(loc->vel_north)*(int32_t)ms )/1112;
+  dlong = ( (int32_t)(loc->vel_east)*(int32_t)ms )/1112;
+
+  //...which is where we are now (a degree of longitude gets shorter away from
+  // the equator, and can't be extrapolated right at the poles)
+  cos_lat = trig_cos( trig_coord_to_angle(gps_nav.lat) );
+  (loc->curr_lat) = gps_nav.lat + dlat;
+  if( cos_lat > (TRIG_ONE >> 6) ){
+    (loc->curr_long) = coord_delta_long( 0,
+      gps_nav.lon + (int32_t)( ((int64_t)dlong << 30)/cos_lat ) );
+  }
+
+  //how far that is from where the distance and azimuth were worked out, in
+  // centimeters...
+  north = ( (loc->curr_lat - gps_calc_lat)*GPS_CM_PER_COORD ) >> 8;
+  east = ( trig_mul(coord_delta_long(gps_calc_long, loc->curr_long),
+                    cos_lat)*GPS_CM_PER_COORD ) >> 8;
+
+  //...toward the destination, and across the way to it
+  dir = trig_coord_to_angle( (int32_t)gps_azimuth*COORD_PER_DEG );
+  along = trig_mul(north, trig_cos(dir)) + trig_mul(east, trig_sin(dir));
+  across = trig_mul(east, trig_cos(dir)) - trig_mul(north, trig_sin(dir));
+
+  //close to the destination the azimuth swings too fast to extrapolate, so
+  // leave the distance and azimuth for the next update
+  if( (int32_t)gps_distance*25 <= labs(along)+labs(across) ){
+    return;
+  }
+
+  //going toward it takes away from the distance, and going across it turns
+  // the azimuth away (radians to degrees is *57.3, and cm to m is /100)
+  (loc->distance) = gps_distance - along/100;
+  gps_calc_delta( loc,
+    gps_azimuth - ((across*573)/1000)/(int32_t)gps_distance );
+}
+
+//gets the position of the last update
+//  (NOTE: this is where the fixes put us, not where gps_predict guessed we
+//   are since, so it's the one to save)
+//  int32_t* lat - where to store the latitude, in units of 1e-7 degrees
+//  int32_t* lon - where to store the longitude, in units of 1e-7 degrees
+void gps_get_position( int32_t* lat, int32_t* lon ){
+  *lat = gps_nav.lat;
+  *lon = gps_nav.lon;
+}
+
+//gets the dilution of precision of the last update
+//  (NOTE: this is the position DOP, PDOP, from either protocol)
+//  returns int - the dilution of precision, rounded down
+int gps_get_dop(){
+#ifndef GPS_PROTOCOL_UBX
+  if( !(gps_decoded & GPS_LAZY_DOP) ){
+    gps_dop = nmea_parse_int( gps_raw.dop );
+    gps_decoded |= GPS_LAZY_DOP;
+  }
+#endif
+
+  return gps_dop;
+}
+
+//gets the altitude of the last update
+//  returns int32_t - the altitude in centimeters
+int32_t gps_get_altitude(){
+#ifndef GPS_PROTOCOL_UBX
+  if( !(gps_decoded & GPS_LAZY_ALTITUDE) ){
+    //meters with two decimals is centimeters
+    gps_altitude = nmea_parse_fixed( gps_raw.altitude, 2 );
+    gps_decoded |= GPS_LAZY_ALTITUDE;
+  }
+#endif
+
+  return gps_altitude;
+}
+
+//gets the speed of the last update
+//  returns int32_t - the speed in centimeters per second
+int32_t gps_get_speed(){
+#ifndef GPS_PROTOCOL_UBX
+  if( !(gps_decoded & GPS_LAZY_SPEED) ){
+    //km/h to cm/s (1km/h is 100000/3600cm/s)
+    gps_speed = ( nmea_parse_fixed(gps_raw.speed, 2)*5 + 9 )/18;
+    gps_decoded |= GPS_LAZY_SPEED;
+  }
+#endif
+
+  return gps_speed;
+}
+
+//gets the satellites in view, as of the last complete set the GPS sent
+//  const gps_sat_t** sats - where to store a pointer to the satellites
+//  returns uint8_t - how many there are, up to GPS_MAX_SATS
+uint8_t gps_get_sats( const gps_sat_t** sats ){
+  *sats = gps_sky;
+  return gps_sky_count;
+}
+
+//get updated GPS data
+//  (NOTE: this function waits until the final line of data has been sent by
+//   the GPS)
+//  loc_state_t* loc - where to store GPS data
+void gps_update( loc_state_t* loc ){
+  while( !gps_poll(loc) ) {}
 }
@@ -23,24 +23,115 @@ SOFTWARE.
 #ifndef __GPS_H
 #define __GPS_H
 
+#include <inttypes.h>
+
+//how many fixes per second to ask the GPS for (1, 5 or 10)
+#ifndef GPS_FIX_RATE
+#define GPS_FIX_RATE 1
+#endif
+
+//the sentences that can make up an update (each is a bit)
+#define GPS_GGA 0x01 //time, position, satellites and altitude
+#define GPS_GSA 0x02 //dilution of precision
+#define GPS_RMC 0x04 //time and heading
+#define GPS_VTG 0x08 //speed
+#define GPS_GSV 0x10 //satellites in view (not part of loc_state_t)
+
+//which sentences have to arrive before an update is used (change it to suit
+//the GPS, it needs at least one of GPS_GGA and GPS_RMC since those have the
+//time that ties an update together)
+#ifndef GPS_REQUIRED_SENTENCES
+#define GPS_REQUIRED_SENTENCES (GPS_GGA|GPS_GSA|GPS_RMC|GPS_VTG)
+#endif
+
 //holds a location state
 struct loc_state {
   //stuff we get from the GPS
   unsigned long time;
-  float curr_lat, curr_long, dest_lat, dest_long;
-  int dop; //diution of positon
+  //coordinates in units of 1e-7 degrees, South and West are negative
+  //  (NOTE: set the destination with gps_set_dest, not directly)
+  int32_t curr_lat, curr_long, dest_lat, dest_long;
   int16_t heading;
   uint8_t sats;
-  float altitude;
-  float speed;
+  uint8_t fix; //1 if the GPS has a fix, 0 otherwise
+  //  (NOTE: the dilution of precision, altitude and speed aren't here, they're
+  //   only decoded when they're asked for, see gps_get_dop etc.)
   //stuff we compute
+  //  (NOTE: the position and heading above are smoothed by the time an update
+  //   is handed back, see navfilter.h)
+  int16_t vel_north, vel_east; //in centimeters per second
+  uint8_t nav; //the NAV_* state of the filter (see navfilter.h)
   int deltaHeading;
-  float distance;
+  uint32_t distance; //in meters
+  uint8_t dist_model; //the DIST_MODEL_* (see coord_dist.h) used for distance
+  uint8_t dest_changed; //1 until the new destination has been worked out
 };
 typedef struct loc_state loc_state_t;
 
-//initializes the GPS
-void gps_init();
+//most satellites in view that are kept track of
+#define GPS_MAX_SATS 16
+
+//a satellite in view, packed into 4 bytes
+struct gps_sat {
+  uint8_t prn;       //which satellite it is
+  uint8_t elevation; //in degrees, 0 to 90
+  uint8_t azimuth;   //in units of 2 degrees, 0 to 179
+  uint8_t snr;       //signal to noise ratio in dB, 0 if it isn't tracked
+};
+typedef struct gps_sat gps_sat_t;
+
+//initializes the GPS, and sets it up to send only the sentences we use
+//  (NOTE: interrupts and the tick need to be on, since this waits for the GPS
+//   to reply)
+//  returns uint8_t - 1 if the GPS took every setting, 0 otherwise
+uint8_t gps_init();
+
+//sets the destination
+//  loc_state_t* loc - the location state to update
+//  int32_t lat, lon - the destination, in units of 1e-7 degrees
+void gps_set_dest( loc_state_t* loc, int32_t lat, int32_t lon );
+
+//parses whatever data the GPS has sent so far, without waiting for more
+//  (NOTE: sentences are parsed as soon as they are complete, but loc is only
+//   updated once every sentence in GPS_REQUIRED_SENTENCES has arrived for
+//   the same time)
+//  loc_state_t* loc - where to store GPS data
+//  returns uint8_t - 1 if the final line of an update was parsed, 0 otherwise
+uint8_t gps_poll( loc_state_t* loc );
+
+//extrapolates the last update to now with the velocity the filter found, so
+//the display can change smoothly between updates
+//  (NOTE: cheap enough to run between sentences, and does nothing without a
+//   fix or once the next update is overdue)
+//  loc_state_t* loc - the last update from gps_poll, its position, distance
+//    and deltaHeading are changed until the next update
+//  uint32_t ms - how long it's been since that update, in milliseconds
+void gps_predict( loc_state_t* loc, uint32_t ms );
+
+//gets the position of the last update
+//  (NOTE: this is where the fixes put us, not where gps_predict guessed we
+//   are since, so it's the one to save)
+//  int32_t* lat - where to store the latitude, in units of 1e-7 degrees
+//  int32_t* lon - where to store the longitude, in units of 1e-7 degrees
+void gps_get_position( int32_t* lat, int32_t* lon );
+
+//gets the dilution of precision of the last update
+//  (NOTE: this is the position DOP, PDOP, from either protocol)
+//  returns int - the dilution of precision, rounded down
+int gps_get_dop();
+
+//gets the altitude of the last update
+//  returns int32_t - the altitude in centimeters
+int32_t gps_get_altitude();
+
+//gets the speed of the last update
+//  returns int32_t - the speed in centimeters per second
+int32_t gps_get_speed();
+
+//gets the satellites in view, as of the last complete set the GPS sent
+//  const gps_sat_t** sats - where to store a pointer to the satellites
+//  returns uint8_t - how many there are, up to GPS_MAX_SATS
+uint8_t gps_get_sats( const gps_sat_t** sats );
 
 //get updated GPS data
 //  (NOTE: this function waits until the final line of data has been sent by
@@ -0,0 +1,17 @@
+//stands in for avr-libc's avr/eeprom.h on the build host (gpstest only)
+#ifndef __GPSTEST_EEPROM_H
+#define __GPSTEST_EEPROM_H
+
+#include <inttypes.h>
+
+#define eeprom_busy_wait()
+#define eeprom_is_ready() 1
+
+uint8_t eeprom_read_byte(const uint8_t* addr);
+void eeprom_write_byte(uint8_t* addr, uint8_t val);
+void eeprom_update_byte(uint8_t* addr, uint8_t val);
+uint32_t eeprom_read_dword(const uint32_t* addr);
+void eeprom_write_dword(uint32_t* addr, uint32_t val);
+void eeprom_update_dword(uint32_t* addr, uint32_t val);
+
+#endif
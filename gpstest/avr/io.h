@@ -0,0 +1,7 @@
+//stands in for avr-libc's avr/io.h on the build host (gpstest only)
+#ifndef __GPSTEST_IO_H
+#define __GPSTEST_IO_H
+
+#include <inttypes.h>
+
+#endif
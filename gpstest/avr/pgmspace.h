@@ -0,0 +1,18 @@
+//stands in for avr-libc's avr/pgmspace.h on the build host (gpstest only)
+//  (NOTE: program memory is just memory here, and the reads keep the type
+//   they're given so a table of pointers reads back whole)
+#ifndef __GPSTEST_PGMSPACE_H
+#define __GPSTEST_PGMSPACE_H
+
+#include <inttypes.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(a) (*(const uint8_t*)(a))
+#define pgm_read_byte_near(a) pgm_read_byte(a)
+#define pgm_read_word(a) (*(a))
+#define pgm_read_word_near(a) pgm_read_word(a)
+#define pgm_read_dword(a) (*(a))
+#define pgm_read_dword_near(a) pgm_read_dword(a)
+
+#endif
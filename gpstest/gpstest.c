@@ -0,0 +1,388 @@
+//checks gps_init and gps_poll against a scripted GPS on the build host
+//  usage: gpstest
+//  (the UART, tick and EEPROM are replaced with fakes here, and the GPS
+//   answers the commands it's sent the way it's told to by each test)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "../gps.h"
+#include "../uart.h"
+#include "../tick.h"
+
+//how long each call to uart_poll takes, in microseconds
+#define POLL_US 5
+//how long the GPS takes to answer a command, in milliseconds
+#define ACK_DELAY 50
+//a flag that isn't one, for a GPS that never answers
+#define NO_ACK -1
+
+//the fake clock, moved on by polling, sending and delays
+static uint32_t now_us;
+
+//the UART's side
+static uint32_t uart_baud;
+
+//the GPS's side
+static struct {
+  uint32_t baud;
+  uint8_t chatty; //1 to send sentences all the time
+  int ack_flag; //the flag it answers commands with, or NO_ACK
+  char out[1024]; //bytes waiting to be sent
+  uint16_t out_len, out_pos;
+  uint32_t next_byte_us; //when the next byte is done being sent
+  int ack_cmd; //the command to answer, 0 if none
+  uint32_t ack_us; //when it's answered
+  char line[128]; //the line being received
+  uint8_t line_len;
+} gps;
+
+//what gps_init sent, checked as it's received
+static char sent[16][128];
+static uint8_t num_sent;
+static uint8_t bad_checksums;
+
+//a tiny EEPROM, enough for the config slot
+static uint8_t eeprom[1024];
+
+//how many checks failed
+static int failures = 0;
+
+//checks a condition, and reports it if it's false
+//  int ok - the condition
+//  const char* what - what was checked
+static void check(int ok, const char* what){
+  if( !ok ){
+    printf("  FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+//works out an NMEA checksum
+//  const char* body - what goes between the "$" and the "*"
+//  uint8_t len - how long it is
+//  returns uint8_t - the checksum
+static uint8_t checksum(const char* body, uint8_t len){
+  uint8_t sum = 0;
+
+  while( len-- > 0 ){
+    sum ^= *body++;
+  }
+
+  return sum;
+}
+
+//queues a sentence for the GPS to send, adding the "$" and checksum
+//  const char* body - what goes between the "$" and the "*"
+static void gps_queue(const char* body){
+  int len;
+
+  //(anything already sent is dropped to make room, and a GPS that had
+  // nothing to send starts sending now)
+  if( (gps.out_pos == gps.out_len) &&
+      ((int32_t)(now_us - gps.next_byte_us) > 0) ){
+    gps.next_byte_us = now_us;
+  }
+  memmove(gps.out, gps.out+gps.out_pos, gps.out_len-gps.out_pos);
+  gps.out_len -= gps.out_pos;
+  gps.out_pos = 0;
+
+  len = snprintf(gps.out+gps.out_len, sizeof(gps.out)-gps.out_len,
+                 "$%s*%02X\r\n", body, checksum(body, strlen(body)));
+  gps.out_len += len;
+}
+
+//lets the GPS do whatever it's due to do by now
+static void gps_run(){
+  char body[32];
+
+  if( gps.ack_cmd && ((int32_t)(now_us - gps.ack_us) >= 0) ){
+    //an answer to some other command first, which has to be ignored
+    gps_queue("PMTK001,101,3");
+    snprintf(body, sizeof(body), "PMTK001,%d,%d", gps.ack_cmd, gps.ack_flag);
+    gps_queue(body);
+    gps.ack_cmd = 0;
+  }
+  if( gps.chatty && (gps.out_pos == gps.out_len) ){
+    gps_queue("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,");
+  }
+}
+
+//checks a line the GPS received, and answers it
+//  const char* line - the line, without the CR LF
+static void gps_receive(const char* line){
+  const char* star = strrchr(line, '*');
+  unsigned int sum;
+  int cmd;
+  unsigned long baud;
+
+  if( num_sent < 16 ){
+    strncpy(sent[num_sent], line, sizeof(sent[0])-1);
+    num_sent++;
+  }
+  if( (line[0] != '$') || (star == NULL) || (strlen(star) != 3) ||
+      (sscanf(star+1, "%2X", &sum) != 1) ||
+      (sum != checksum(line+1, star-line-1)) ){
+    bad_checksums++;
+    return;
+  }
+
+  //at the wrong baud rate, it's garbage to the GPS
+  if( uart_baud != gps.baud ){
+    return;
+  }
+  if( sscanf(line, "$PMTK251,%lu", &baud) == 1 ){
+    gps.baud = baud;
+  } else if( (sscanf(line, "$PMTK%d", &cmd) == 1) &&
+             (gps.ack_flag != NO_ACK) ){
+    gps.ack_cmd = cmd;
+    gps.ack_us = now_us + ACK_DELAY*1000UL;
+  }
+}
+
+//the fake UART
+void uart_init(unsigned long baudrate){
+  uart_baud = baudrate;
+}
+
+void uart_send(char data){
+  //(a start bit, 8 data bits and a stop bit)
+  now_us += 10000000UL/uart_baud;
+
+  if( data == '\n' ){
+    gps.line[gps.line_len] = '\0';
+    gps_receive(gps.line);
+    gps.line_len = 0;
+  } else if( (data != '\r') && (gps.line_len < sizeof(gps.line)-1) ){
+    gps.line[gps.line_len] = data;
+    gps.line_len++;
+  }
+}
+
+void uart_print8(uint8_t val){
+  char hex[3];
+
+  snprintf(hex, sizeof(hex), "%02X", val);
+  uart_send(hex[0]);
+  uart_send(hex[1]);
+}
+
+uint8_t uart_poll(char* data){
+  now_us += POLL_US;
+  gps_run();
+
+  if( (gps.out_pos == gps.out_len) ||
+      ((int32_t)(now_us - gps.next_byte_us) < 0) ){
+    return 0;
+  }
+
+  *data = gps.out[gps.out_pos];
+  gps.out_pos++;
+  //(bytes come in at the baud rate however often they're polled for)
+  gps.next_byte_us += 10000000UL/gps.baud;
+  //at the wrong baud rate, what comes in is garbled
+  if( uart_baud != gps.baud ){
+    *data ^= 0x5A;
+  }
+
+  return 1;
+}
+
+//the fake tick
+void fake_delay_us(uint32_t us){
+  now_us += us;
+}
+
+uint32_t tick_ms(){
+  return now_us/1000;
+}
+
+void tick_timer_start(tick_timer_t* t, uint16_t ms){
+  *t = tick_ms() + ms;
+}
+
+uint8_t tick_timer_expired(const tick_timer_t* t){
+  return ( (int32_t)(tick_ms() - *t) >= 0 );
+}
+
+//the fake EEPROM
+uint8_t eeprom_read_byte(const uint8_t* addr){
+  return eeprom[(uintptr_t)addr];
+}
+
+void eeprom_write_byte(uint8_t* addr, uint8_t val){
+  eeprom[(uintptr_t)addr] = val;
+}
+
+void eeprom_update_byte(uint8_t* addr, uint8_t val){
+  eeprom_write_byte(addr, val);
+}
+
+uint32_t eeprom_read_dword(const uint32_t* addr){
+  uint32_t val;
+
+  memcpy(&val, &eeprom[(uintptr_t)addr], sizeof(val));
+  return val;
+}
+
+void eeprom_write_dword(uint32_t* addr, uint32_t val){
+  memcpy(&eeprom[(uintptr_t)addr], &val, sizeof(val));
+}
+
+void eeprom_update_dword(uint32_t* addr, uint32_t val){
+  eeprom_write_dword(addr, val);
+}
+
+//starts a test over, with a blank EEPROM and a GPS that's just been powered
+//  const char* name - what's being tested
+//  uint32_t baud - the GPS's baud rate
+//  uint8_t chatty - 1 if the GPS sends sentences, 0 if it's silent
+//  int ack_flag - the flag it answers commands with, or NO_ACK
+static void start(const char* name, uint32_t baud, uint8_t chatty,
+                  int ack_flag){
+  printf("%s\n", name);
+
+  memset(eeprom, 0xFF, sizeof(eeprom));
+  memset(&gps, 0, sizeof(gps));
+  gps.baud = baud;
+  gps.chatty = chatty;
+  gps.ack_flag = ack_flag;
+  uart_baud = baud;
+  num_sent = 0;
+  bad_checksums = 0;
+  now_us = 0;
+}
+
+//checks that a sentence was sent, with the right checksum
+//  uint8_t idx - which one
+//  const char* body - what it should have between the "$" and the "*"
+static void check_sent(uint8_t idx, const char* body){
+  char expect[128];
+
+  snprintf(expect, sizeof(expect), "$%s*%02X",
+           body, checksum(body, strlen(body)));
+  if( (idx >= num_sent) || (strcmp(sent[idx], expect) != 0) ){
+    printf("  FAIL: sentence %d is \"%s\", not \"%s\"\n",
+           idx, (idx < num_sent) ? sent[idx] : "", expect);
+    failures++;
+  }
+}
+
+//has the GPS send sentences, and runs gps_poll until they've all come in
+//  const char* const* bodies - what goes between the "$" and the "*" of each,
+//    ending with NULL
+//  returns int - how many complete updates gps_poll handed over
+static int poll_sentences(const char* const* bodies){
+  loc_state_t loc;
+  int updates = 0;
+
+  while( *bodies ){
+    gps_queue(*bodies);
+    bodies++;
+  }
+  while( gps.out_pos < gps.out_len ){
+    updates += gps_poll(&loc);
+  }
+
+  return updates;
+}
+
+int main(){
+  static const char SET_OUTPUT[] =
+    "PMTK314,0,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0";
+  static const char SET_RATE[] = "PMTK220,1000";
+  uint8_t i;
+
+  //a GPS at 9600 baud that takes everything: it's moved to 115200, then set
+  // up
+  start("ACK", 9600, 1, 3);
+  check(gps_init() == 1, "gps_init returns 1");
+  check(bad_checksums == 0, "every checksum is right");
+  check(num_sent == 3, "3 sentences are sent");
+  check_sent(0, "PMTK251,115200");
+  check_sent(1, SET_OUTPUT);
+  check_sent(2, SET_RATE);
+  check(gps.baud == 115200, "the GPS is at 115200 baud");
+  check(uart_baud == 115200, "the UART is at 115200 baud");
+
+  //a GPS that refuses every command: each is tried 3 times
+  start("NAK", 115200, 1, 2);
+  check(gps_init() == 0, "gps_init returns 0");
+  check(bad_checksums == 0, "every checksum is right");
+  check(num_sent == 6, "6 sentences are sent");
+  for( i = 0; i < 3; i++ ){
+    check_sent(i, SET_OUTPUT);
+    check_sent(3+i, SET_RATE);
+  }
+  check(tick_ms() < 1000, "no time is spent waiting for answers");
+
+  //a GPS that sends all the time but never answers: the wait for each
+  // answer still times out
+  start("no answer", 115200, 1, NO_ACK);
+  check(gps_init() == 0, "gps_init returns 0");
+  check(bad_checksums == 0, "every checksum is right");
+  check(num_sent == 6, "6 sentences are sent");
+  check((tick_ms() >= 6000) && (tick_ms() < 6200),
+        "it waits a second for each answer");
+
+  //a GPS that's silent: nothing is sent, since it was never heard
+  start("silence", 115200, 0, 3);
+  check(gps_init() == 0, "gps_init returns 0");
+  check(num_sent == 0, "nothing is sent");
+  check(uart_baud == 115200, "the UART is left at 115200 baud");
+  check(tick_ms() < 10000, "it gives up within 10 seconds");
+
+  //a GPS that sends the satellites in view after the rest of each update (the
+  // u-blox order): they go with the update before them, and a set that's cut
+  // off by the next update isn't shown
+  start("GSV last", 115200, 0, 3);
+  {
+    static const char* const FIRST[] = {
+      "GPRMC,120000.000,A,4313.4782,N,07743.5755,W,10.0,45.0,010112,,,A",
+      "GPVTG,45.0,T,,M,10.0,N,18.5,K,A",
+      "GPGGA,120000.000,4313.4782,N,07743.5755,W,1,05,2.0,100.0,M,-34.5,M,,",
+      "GPGSA,A,3,01,02,03,04,05,,,,,,,,3.0,2.0,2.0",
+      "GPGSV,2,1,05,01,66,080,40,02,60,160,35,03,54,239,30,04,53,064,25",
+      "GPGSV,2,2,05,05,44,309,20",
+      NULL
+    };
+    static const char* const CUT_OFF[] = {
+      "GPRMC,120001.000,A,4313.4782,N,07743.5755,W,10.0,45.0,010112,,,A",
+      "GPVTG,45.0,T,,M,10.0,N,18.5,K,A",
+      "GPGGA,120001.000,4313.4782,N,07743.5755,W,1,03,2.0,100.0,M,-34.5,M,,",
+      "GPGSA,A,3,07,08,09,,,,,,,,,,3.0,2.0,2.0",
+      "GPGSV,2,1,05,07,66,080,40,08,60,160,35,09,54,239,30,10,53,064,",
+      NULL
+    };
+    static const char* const NEXT[] = {
+      "GPRMC,120002.000,A,4313.4782,N,07743.5755,W,10.0,45.0,010112,,,A",
+      "GPGSV,2,2,05,11,44,309,",
+      "GPVTG,45.0,T,,M,10.0,N,18.5,K,A",
+      "GPGGA,120002.000,4313.4782,N,07743.5755,W,1,03,2.0,100.0,M,-34.5,M,,",
+      "GPGSA,A,3,07,08,09,,,,,,,,,,3.0,2.0,2.0",
+      "GPGSV,1,1,03,07,66,080,40,08,60,160,35,09,54,239,30",
+      NULL
+    };
+    const gps_sat_t* sats;
+
+    check(poll_sentences(FIRST) == 1, "the first update is handed over");
+    check(gps_get_sats(&sats) == 5, "5 satellites are in view");
+    check((sats[0].prn == 1) && (sats[0].snr == 40) &&
+          (sats[4].prn == 5) && (sats[4].snr == 20),
+          "the satellites are the ones that were sent");
+    check(poll_sentences(CUT_OFF) == 1, "the second update is handed over");
+    check((gps_get_sats(&sats) == 5) && (sats[0].prn == 1),
+          "half a set of satellites isn't shown");
+    check(poll_sentences(NEXT) == 1, "the third update is handed over");
+    check((gps_get_sats(&sats) == 3) && (sats[0].prn == 7),
+          "the third update's satellites are shown");
+  }
+
+  if( failures ){
+    printf("%d failed\n", failures);
+    return 1;
+  }
+  printf("all passed\n");
+  return 0;
+}
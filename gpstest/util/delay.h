@@ -0,0 +1,13 @@
+//stands in for avr-libc's util/delay.h on the build host (gpstest only)
+//  (NOTE: delays move the fake clock on instead of waiting)
+#ifndef __GPSTEST_DELAY_H
+#define __GPSTEST_DELAY_H
+
+#include <inttypes.h>
+
+void fake_delay_us(uint32_t us);
+
+#define _delay_ms(ms) fake_delay_us((uint32_t)((ms)*1000))
+#define _delay_us(us) fake_delay_us((uint32_t)(us))
+
+#endif
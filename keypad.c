@@ -21,7 +21,8 @@ SOFTWARE.
 ***/
 
 #include <avr/io.h>
-#include <util/delay.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 #include "keypad.h"
 #include "keys.h"
 
@@ -46,60 +47,66 @@ const uint16_t __KEYPAD_KEY_STAR = 1<<9;
 const uint16_t __KEYPAD_KEY_0 = 1<<10;
 const uint16_t __KEYPAD_KEY_POUND = 1<<11;
 
+//how many rows the keypad has (must be a power of two), one is read every
+//interrupt
+#define KEYPAD_ROWS 4
+//how often to read a row, in microseconds (so every key is sampled every 2ms)
+#define KEYPAD_ROW_TIME 500
+//Timer0 counts F_CPU/64, this is where it clears every row (it has to fit
+// in 8 bits, which it does up to 32MHz)
+#define KEYPAD_TIMER_TOP (F_CPU/64*KEYPAD_ROW_TIME/1000000-1)
+//how many samples a key's integrator counts up to, it's pressed when it gets
+// there and let go of when it gets back down to 0 (10ms)
+static const uint8_t __KEYPAD_INTEGRATOR_MAX = 5;
+//how many samples a key has to be held for a long press (600ms), and then
+// between repeats (100ms)
+static const uint16_t __KEYPAD_LONG_SAMPLES = 300;
+static const uint16_t __KEYPAD_REPEAT_SAMPLES = 50;
+
+//how many keys there are
+#define KEYPAD_NUM_KEYS 12
+//how many events can be waiting (must be a power of two)
+#define KEYPAD_QUEUE_LEN 8
+#define KEYPAD_QUEUE_MASK (KEYPAD_QUEUE_LEN-1)
+
+//the debounced state of the keypad
+static volatile uint16_t keypad_state = 0;
+//each key's integrator
+static uint8_t keypad_integrator[KEYPAD_NUM_KEYS];
+//the row being driven, which is read at the next interrupt
+static uint8_t keypad_row = 0;
+//the last key pressed (0 once it's let go of), and how long it's been held
+static uint16_t keypad_held = 0;
+static uint16_t keypad_held_time = 0;
+
+//events waiting to be read
+//  the ISR is the only writer of keypad_head and the main program is the only
+//  writer of keypad_tail, and both are single bytes, so no locking is needed
+static volatile keypad_event_t keypad_queue[KEYPAD_QUEUE_LEN];
+static volatile uint8_t keypad_head = 0;
+static volatile uint8_t keypad_tail = 0;
+
 //initialize the keypad
 void keypad_init(){
   //set rows to output
   __KEYPAD_DDR |= __KEYPAD_ROW_MASK;
   //set columns to input
   __KEYPAD_DDR &= ~__KEYPAD_COL_MASK;
+  //drive the first row, it has until the first interrupt to settle
+  __KEYPAD_PORT = (__KEYPAD_PORT & ~__KEYPAD_ROW_MASK) | (1 << keypad_row);
+
+  //read a row every KEYPAD_ROW_TIME (CTC mode, F_CPU/64)
+  TCCR0A = (1<<WGM01);
+  TCCR0B = (1<<CS01)|(1<<CS00);
+  OCR0A = KEYPAD_TIMER_TOP;
+  TIMSK0 |= (1<<OCIE0A);
 }
 
-//gets the state of the keypad
-//  returns uint16_t - the state of the keypad
-uint16_t keypad_getst(){
-  uint16_t result = 0x0000;
-  uint8_t i;
-
-  //read in each row at a time
-  for( i=0; i<4; i++){
-    //clear row bits
-    __KEYPAD_PORT &= ~__KEYPAD_ROW_MASK;
-    //set the row
-    __KEYPAD_PORT |= ((1 << i) & __KEYPAD_ROW_MASK);
-    //let the inputs settle
-    _delay_us(1);
-
-    //read the columns
-    result |= (((__KEYPAD_PIN & __KEYPAD_COL_MASK)>>4) << (i * 3));
-  }
-
-  return result;
-}
-
-//gets the debounced state of the keypad
-//  returns uint16_t - the debounced state of the keypad
-uint16_t keypad_getst_deb(){
-  uint16_t keyst;
-
-  //get the key states and debounce them
-  keyst = keypad_getst();
-  _delay_ms(5);
-  keyst &= keypad_getst();
-  _delay_ms(5);
-  keyst &= keypad_getst();
-  _delay_ms(5);
-  keyst &= keypad_getst();
-  _delay_ms(5);
-  keyst &= keypad_getst();
-
-  return keyst;
-}
-
-//gets a character from the keypad, uses debouncing
-//  returns char - \0 if no key entered, otherwise the button pressed
-char keypad_getchar(){
+//converts the state of the keypad to a character
+//  uint16_t keyst - the state of the keypad
+//  returns char - \0 if no key is down, otherwise the first button that is
+static char keypad_to_char(uint16_t keyst){
   char result = NO_BUTTON;
-  uint16_t keyst = keypad_getst_deb();
 
   if(keyst & __KEYPAD_KEY_1){
       result = '1';
@@ -129,3 +136,102 @@ char keypad_getchar(){
 
   return result;
 }
+
+//adds an event to the queue
+//  (NOTE: if the queue is full, the event is dropped)
+//  uint16_t key - the key's bit in the state of the keypad
+//  uint8_t type - one of the KEYPAD_* event types
+static void keypad_push(uint16_t key, uint8_t type){
+  uint8_t next = (keypad_head+1) & KEYPAD_QUEUE_MASK;
+
+  if( next != keypad_tail ){
+    keypad_queue[keypad_head].key = keypad_to_char(key);
+    keypad_queue[keypad_head].type = type;
+    keypad_head = next;
+  }
+}
+
+//reads a row of the keypad and debounces its keys
+//  (NOTE: the row was driven at the last interrupt, so there's no waiting for
+//   the inputs to settle)
+ISR(TIMER0_COMPA_vect){
+  //the columns that are down, and the first of the row's keys
+  uint8_t cols = (__KEYPAD_PIN & __KEYPAD_COL_MASK) >> 4;
+  uint8_t i = keypad_row*3;
+  uint8_t end = i+3;
+  uint16_t bit = 1 << i;
+
+  //drive the next row while this one's keys are worked out
+  keypad_row = (keypad_row+1) & (KEYPAD_ROWS-1);
+  __KEYPAD_PORT = (__KEYPAD_PORT & ~__KEYPAD_ROW_MASK) | (1 << keypad_row);
+
+  //each key's integrator counts up while it's down and down while it's up,
+  // so a bounce only sets it back a little
+  for(; i<end; i++){
+    if( cols & 1 ){
+      if( keypad_integrator[i] < __KEYPAD_INTEGRATOR_MAX ){
+        keypad_integrator[i]++;
+        if( (keypad_integrator[i] == __KEYPAD_INTEGRATOR_MAX) &&
+            !(keypad_state & bit) ){
+          keypad_state |= bit;
+          keypad_push(bit, KEYPAD_PRESS);
+          //the newest key is the one that's timed for long presses
+          keypad_held = bit;
+          keypad_held_time = 0;
+        }
+      }
+    } else if( keypad_integrator[i] > 0 ){
+      keypad_integrator[i]--;
+      if( (keypad_integrator[i] == 0) && (keypad_state & bit) ){
+        keypad_state &= ~bit;
+        keypad_push(bit, KEYPAD_RELEASE);
+        if( keypad_held == bit ){
+          keypad_held = 0;
+        }
+      }
+    }
+
+    cols >>= 1;
+    bit <<= 1;
+  }
+
+  //a key that's held down long enough is a long press, and then repeats
+  // (timed once a scan, when it's back to the first row)
+  if( keypad_held && (keypad_row == 0) ){
+    keypad_held_time++;
+    if( keypad_held_time == __KEYPAD_LONG_SAMPLES ){
+      keypad_push(keypad_held, KEYPAD_LONG);
+    } else if( keypad_held_time ==
+               __KEYPAD_LONG_SAMPLES+__KEYPAD_REPEAT_SAMPLES ){
+      keypad_push(keypad_held, KEYPAD_REPEAT);
+      keypad_held_time = __KEYPAD_LONG_SAMPLES;
+    }
+  }
+}
+
+//gets a character from the keypad, uses debouncing
+//  returns char - \0 if no key is down, otherwise the button that is
+char keypad_getchar(){
+  uint16_t keyst;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+    keyst = keypad_state;
+  }
+
+  return keypad_to_char(keyst);
+}
+
+//gets the next key event
+//  keypad_event_t* e - where to store the event
+//  returns uint8_t - 1 if there was one, 0 otherwise
+uint8_t keypad_get_event(keypad_event_t* e){
+  if( keypad_tail == keypad_head ){
+    return 0;
+  }
+
+  e->key = keypad_queue[keypad_tail].key;
+  e->type = keypad_queue[keypad_tail].type;
+  keypad_tail = (keypad_tail+1) & KEYPAD_QUEUE_MASK;
+
+  return 1;
+}
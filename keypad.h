@@ -25,13 +25,33 @@ SOFTWARE.
 
 #include <inttypes.h> //for uint16_t, uint8_t
 
+//what happened to a key
+#define KEYPAD_PRESS   0 //it was pressed
+#define KEYPAD_RELEASE 1 //it was let go of
+#define KEYPAD_LONG    2 //it's been held down for a while...
+#define KEYPAD_REPEAT  3 //...and again every so often after that
+
+//a key event (see keypad_get_event)
+struct keypad_event {
+  char key;     //the button, e.g. '1'
+  uint8_t type; //one of the KEYPAD_* events
+};
+typedef struct keypad_event keypad_event_t;
+
 //initialize the keypad
+//  (NOTE: it's scanned from a Timer0 interrupt from then on, interrupts need
+//   to be on)
 void keypad_init();
 
 //gets a character from the keypad, uses debouncing
-//  returns char - \0 if no key entered, otherwise the button pressed
+//  returns char - \0 if no key is down, otherwise the button that is
 char keypad_getchar();
 
+//gets the next key event
+//  keypad_event_t* e - where to store the event
+//  returns uint8_t - 1 if there was one, 0 otherwise
+uint8_t keypad_get_event(keypad_event_t* e);
+
 //get a string of null-terminated input from the keypad
 // char* str - the string buffer to write to
 // uint8_t maxlen - the maximum length of the string buffer
@@ -27,6 +27,7 @@ SOFTWARE.
 #define RIGHT_BUTTON '3'
 #define GOHOME_BUTTON '.'
 #define ENTER_BUTTON '#'
+#define PRECISE_BUTTON '5'
 #define NO_BUTTON '\0'
 
 #endif
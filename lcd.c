@@ -37,6 +37,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <inttypes.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <avr/pgmspace.h>
 #include <util/delay.h>
 #include "lcd.h"
@@ -53,12 +55,72 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define lcd_rw_low()    LCD_PORT &= ~_BV(LCD_RW_PIN)
 #define lcd_rs_high()   LCD_PORT |=  _BV(LCD_RS_PIN)
 #define lcd_rs_low()    LCD_PORT &= ~_BV(LCD_RS_PIN)
-#define LCD_DATA_MASK   0x0F
 
-#if LCD_LINES==1
-  #define LCD_FUNCTION_DEFAULT    LCD_FUNCTION_4BIT_1LINE
+#if LCD_8BIT
+  #define LCD_DATA_BITS   0xFF
+#else
+  //the data lines are 4 pins in a row, so a nibble goes out in one write
+  #if (LCD_DATA1_PIN != LCD_DATA0_PIN+1) || \
+      (LCD_DATA2_PIN != LCD_DATA0_PIN+2) || \
+      (LCD_DATA3_PIN != LCD_DATA0_PIN+3)
+    #error "LCD_DATA0_PIN..LCD_DATA3_PIN have to be four pins in a row"
+  #endif
+  #define LCD_DATA_BITS   (0x0F << LCD_DATA0_PIN)
+
+  //moves each nibble of a byte to the data pins, worked out at compile time
+  //(on bits 0..3 or 4..7, it's a swap at most, or nothing at all)
+  #if LCD_DATA0_PIN==0
+    #define lcd_high_nibble(d)  ((d)>>4)
+    #define lcd_low_nibble(d)   (d)
+  #elif LCD_DATA0_PIN==4
+    #define lcd_high_nibble(d)  (d)
+    #define lcd_low_nibble(d)   ((d)<<4)
+  #else
+    #define lcd_high_nibble(d)  (((d)>>4)<<LCD_DATA0_PIN)
+    #define lcd_low_nibble(d)   ((d)<<LCD_DATA0_PIN)
+  #endif
+#endif
+
+#if LCD_8BIT
+  #if LCD_LINES==1
+    #define LCD_FUNCTION_DEFAULT    LCD_FUNCTION_8BIT_1LINE
+  #else
+    #define LCD_FUNCTION_DEFAULT    LCD_FUNCTION_8BIT_2LINES
+  #endif
 #else
-  #define LCD_FUNCTION_DEFAULT    LCD_FUNCTION_4BIT_2LINES
+  #if LCD_LINES==1
+    #define LCD_FUNCTION_DEFAULT    LCD_FUNCTION_4BIT_1LINE
+  #else
+    #define LCD_FUNCTION_DEFAULT    LCD_FUNCTION_4BIT_2LINES
+  #endif
+#endif
+
+/*
+** local variables
+*/
+
+//the address counter, kept track of here so it never has to be read back
+static uint8_t lcd_addr = 0;
+//1 if the address counter points into DDRAM, 0 if it's in CGRAM
+static uint8_t lcd_in_ddram = 1;
+
+#if LCD_ASYNC
+#if LCD_QUEUE_LEN > 255
+#error "LCD_QUEUE_LEN must be no larger than 255"
+#endif
+
+//a write waiting to be sent to the LCD
+struct lcd_queued {
+  uint8_t data;
+  uint8_t rs; //1 for data, 0 for an instruction
+};
+
+//the writes waiting to be sent, oldest first (see the TIMER2_COMPA ISR)
+static volatile struct lcd_queued lcd_queue[LCD_QUEUE_LEN];
+static volatile uint8_t lcd_queue_head = 0;
+static volatile uint8_t lcd_queue_count = 0;
+//how many more ticks the last write takes (clear and home take many)
+static volatile uint8_t lcd_queue_wait = 0;
 #endif
 
 /*
@@ -78,13 +140,22 @@ static void toggle_e(void)
 }
 
 /*************************************************************************
-Write a value to the 4-bit data port
-Input:    data   data to write to LCD (only lower 4 bits used)
+Write a value to the data port
+Input:    bits   what to put on the data pins (already where the pins are,
+                 the other bits are ignored)
 Returns:  none
 *************************************************************************/
-static void lcd_set_databus(uint8_t data){
-  LCD_PORT &= ~( LCD_DATA_MASK << LCD_DATA0_PIN );
-  LCD_PORT |= ( (data&LCD_DATA_MASK) << LCD_DATA0_PIN );
+static inline void lcd_set_databus(uint8_t bits){
+#if LCD_8BIT
+  //(the data lines are the whole port, so nothing else can be on it)
+  LCD_DATA_PORT = bits;
+#else
+  //RS, RW, E and whatever else is on the port share it with the nibble, so
+  // they have to be read back, and nothing can change them in between
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+    LCD_PORT = ( LCD_PORT & ~LCD_DATA_BITS ) | ( bits & LCD_DATA_BITS );
+  }
+#endif
 }
 
 /*************************************************************************
@@ -101,34 +172,47 @@ static void lcd_write(uint8_t data, uint8_t rs)
   } else {  //write instruction (RS=0, RW=0)
     lcd_rs_low();
   }
+#if !LCD_WRITE_ONLY
   lcd_rw_low();
+#endif
+
+#if LCD_8BIT
+  //configure data pins as output
+  LCD_DATA_DDR = LCD_DATA_BITS;
 
+  //output the whole byte at once
+  lcd_set_databus(data);
+  lcd_e_toggle();
+#else
   //configure data pins as output
-  LCD_DDR |= (LCD_DATA_MASK << LCD_DATA0_PIN);
+  LCD_DDR |= LCD_DATA_BITS;
 
   //output high nibble first
-  lcd_set_databus(data>>4);
+  lcd_set_databus(lcd_high_nibble(data));
   lcd_e_toggle();
 
   //output low nibble
-  lcd_set_databus(data);
+  lcd_set_databus(lcd_low_nibble(data));
   lcd_e_toggle();
+#endif
 
   //all data pins high (inactive)
   lcd_set_databus(0xFF);
 }
 
+#if !LCD_WRITE_ONLY && !LCD_ASYNC
 /*************************************************************************
-Write a value to the 4-bit data port
+Read a value from the data port
 Input:    none
-Returns:  halfbyte read from LCD controller (only lower 4 bits used)
+Returns:  byte (8-bit mode) or halfbyte (4-bit mode, only lower 4 bits used)
+          read from LCD controller
 *************************************************************************/
 static uint8_t lcd_read_databus(void){
-  uint8_t result = 0x00;
-
-  result |= ( (LCD_PIN>>LCD_DATA0_PIN)&LCD_DATA_MASK );
-
-  return result;
+#if LCD_8BIT
+  return LCD_DATA_PIN;
+#else
+  return ( (LCD_PIN & LCD_DATA_BITS) >> LCD_DATA0_PIN );
+#endif
 }
 
 /*************************************************************************
@@ -147,8 +231,18 @@ static uint8_t lcd_read(uint8_t rs)
       lcd_rs_low();  //RS=0: read busy flag
   lcd_rw_high();     //RW=1  read mode
 
+#if LCD_8BIT
+  //configure data pins as input
+  LCD_DATA_DDR = 0x00;
+
+  //read the whole byte at once
+  lcd_e_high();
+  lcd_e_delay();
+  data = lcd_read_databus();
+  lcd_e_low();
+#else
   //configure data pins as input
-  LCD_DDR &= ~(LCD_DATA_MASK << LCD_DATA0_PIN);
+  LCD_DDR &= ~LCD_DATA_BITS;
 
   //read high nibble first
   lcd_e_high();
@@ -163,6 +257,7 @@ static uint8_t lcd_read(uint8_t rs)
   lcd_e_delay();
   data |= ( lcd_read_databus() );
   lcd_e_low();
+#endif
 
   return data;
 }
@@ -170,22 +265,64 @@ static uint8_t lcd_read(uint8_t rs)
 /*************************************************************************
 loops while lcd is busy
 Input:    none
-Returns:  address counter
+Returns:  none
 *************************************************************************/
-static uint8_t lcd_waitbusy(void)
+static void lcd_waitbusy(void)
 {
-    register uint8_t c;
-
-    //wait until busy flag is cleared
-    while ( (c=lcd_read(0)) & (1<<LCD_BUSY)) {}
-
-    //the address counter is updated 4us after the busy flag is cleared
-    _delay_us(2);
+    //wait until busy flag is cleared (the address counter isn't read, it's
+    //kept track of in lcd_addr)
+    while ( lcd_read(0) & (1<<LCD_BUSY)) {}
+}//lcd_waitbusy
+#else
+/*************************************************************************
+there's no busy flag without the RW line (or in the queue's interrupt), the
+writes wait instead
+*************************************************************************/
+#define lcd_waitbusy()
+#endif
 
-    //now read the address counter
-    return (lcd_read(0));  // return address counter
+/*************************************************************************
+Finds where the address counter goes after a character is written
+Input:    the current address counter
+Returns:  the next address counter
+*************************************************************************/
+static uint8_t lcd_next_addr(uint8_t pos)
+{
+    pos++;
+#if LCD_LINES==1
+    //one line is 80 characters long
+    if ( pos == 0x50 )
+        pos = 0;
+#else
+    //two lines are 40 characters each, the second starts at 0x40
+    if ( pos == 0x28 )
+        pos = 0x40;
+    else if ( pos == 0x68 )
+        pos = 0;
+#endif
+    return pos;
+}//lcd_next_addr
 
-}//lcd_waitbusy
+/*************************************************************************
+Keeps track of where a command moves the address counter
+Input:    the command that was written
+Returns:  none
+*************************************************************************/
+static void lcd_track_command(uint8_t cmd)
+{
+    if ( cmd & (1<<LCD_DDRAM) ) {
+        lcd_addr = cmd & ~(1<<LCD_DDRAM);
+        lcd_in_ddram = 1;
+    } else if ( cmd & (1<<LCD_CGRAM) ) {
+        lcd_in_ddram = 0;
+    } else if ( cmd == LCD_MOVE_CURSOR_RIGHT ) {
+        lcd_addr = lcd_next_addr(lcd_addr);
+    } else if ( cmd < (1<<LCD_ENTRY_MODE) ) {
+        //clear and home
+        lcd_addr = 0;
+        lcd_in_ddram = 1;
+    }
+}//lcd_track_command
 
 
 /*************************************************************************
@@ -273,6 +410,75 @@ static void lcd_getxy(uint8_t pos, uint8_t* x, uint8_t* y){
 
 }//lcd_getxy
 
+#if LCD_ASYNC
+/*************************************************************************
+Sends the next queued write to the LCD, every LCD_DELAY_CMD_US
+(the interrupt is only on while there's something to send)
+*************************************************************************/
+ISR(TIMER2_COMPA_vect)
+{
+    uint8_t data;
+
+    //the last write isn't done yet
+    if ( lcd_queue_wait ) {
+        lcd_queue_wait--;
+        return;
+    }
+
+    if ( lcd_queue_count == 0 ) {
+        TIMSK2 &= ~_BV(OCIE2A);
+        return;
+    }
+
+    data = lcd_queue[lcd_queue_head].data;
+    if ( lcd_queue[lcd_queue_head].rs ) {
+        lcd_write(data, 1);
+    } else {
+        lcd_write(data, 0);
+        //clear and home take much longer
+        if ( data < (1<<LCD_ENTRY_MODE) )
+            lcd_queue_wait = LCD_DELAY_CLEAR_US/LCD_DELAY_CMD_US;
+    }
+    lcd_queue_head = (lcd_queue_head+1) % LCD_QUEUE_LEN;
+    lcd_queue_count--;
+}
+
+/*************************************************************************
+Sets up Timer2 to send the queue, one write every LCD_DELAY_CMD_US
+Input:    none
+Returns:  none
+*************************************************************************/
+static void lcd_queue_init(void)
+{
+    //count every 8 CPU cycles, clearing at OCR2A (CTC mode)
+    TCCR2A = _BV(WGM21);
+    TCCR2B = _BV(CS21);
+    OCR2A = ((F_CPU/8) * LCD_DELAY_CMD_US)/1000000 - 1;
+}
+
+/*************************************************************************
+Queues a write to the LCD, waiting for room if the queue is full
+Input:    data   byte to write to LCD
+          rs     1: write data
+                 0: write instruction
+Returns:  none
+*************************************************************************/
+static void lcd_queue_put(uint8_t data, uint8_t rs)
+{
+    volatile struct lcd_queued* q;
+
+    while ( lcd_queue_count == LCD_QUEUE_LEN ) {}
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        q = &lcd_queue[(lcd_queue_head+lcd_queue_count) % LCD_QUEUE_LEN];
+        q->data = data;
+        q->rs = rs;
+        lcd_queue_count++;
+        TIMSK2 |= _BV(OCIE2A);
+    }
+}
+#endif
+
 /*
 ** PUBLIC FUNCTIONS
 */
@@ -284,8 +490,19 @@ Returns: none
 *************************************************************************/
 void lcd_command(uint8_t cmd)
 {
+#if LCD_ASYNC
+    lcd_queue_put(cmd,0);
+#else
     lcd_waitbusy();
     lcd_write(cmd,0);
+  #if LCD_WRITE_ONLY
+    if ( cmd < (1<<LCD_ENTRY_MODE) ) //clear and home take much longer
+        _delay_us(LCD_DELAY_CLEAR_US);
+    else
+        _delay_us(LCD_DELAY_CMD_US);
+  #endif
+#endif
+    lcd_track_command(cmd);
 }
 
 
@@ -296,8 +513,30 @@ Returns: none
 *************************************************************************/
 void lcd_data(uint8_t data)
 {
+#if LCD_ASYNC
+    lcd_queue_put(data,1);
+#else
     lcd_waitbusy();
     lcd_write(data,1);
+  #if LCD_WRITE_ONLY
+    _delay_us(LCD_DELAY_CMD_US);
+  #endif
+#endif
+    if ( lcd_in_ddram )
+        lcd_addr = lcd_next_addr(lcd_addr);
+}
+
+/*************************************************************************
+Wait until every queued write has been sent to the LCD
+Input:   none
+Returns: none
+*************************************************************************/
+void lcd_flush(void)
+{
+#if LCD_ASYNC
+    //(the last write has to be done too)
+    while ( lcd_queue_count || lcd_queue_wait ) {}
+#endif
 }
 
 
@@ -358,12 +597,12 @@ void lcd_putc(char c)
 {
   uint8_t pos, x, y;
 
-  pos = lcd_waitbusy(); //read busy-flag and address counter
+  pos = lcd_addr; //(never read back, see lcd_track_command)
   if (c=='\n') {
     lcd_newline(pos);
   } else {
     lcd_getxy(pos, &x, &y);
-    lcd_write(c, 1);
+    lcd_data(c);
 
     //if, before writing that character, the cursor was at the end of the line
     if( x == (LCD_DISP_LENGTH-1) ){
@@ -381,6 +620,24 @@ void lcd_putc(char c)
 }//lcd_putc
 
 
+/*************************************************************************
+Display a run of characters, setting the address only once
+Input:    x    horizontal position of the first character
+          y    vertical position
+          s    characters to be displayed (not interpreted, not wrapped)
+          len  how many characters there are
+Returns:  none
+*************************************************************************/
+void lcd_write_block(uint8_t x, uint8_t y, const char *s, uint8_t len)
+{
+    //(the address counter moves along the run by itself)
+    lcd_gotoxy(x, y);
+    while ( len-- ) {
+        lcd_data(*s++);
+    }
+}//lcd_write_block
+
+
 /*************************************************************************
 Display string without auto linefeed
 Input:    string to be displayed
@@ -448,20 +705,27 @@ Returns:  none
 *************************************************************************/
 void lcd_init(uint8_t dispAttr)
 {
-  //Initialize LCD to 4 bit I/O mode
+  //Initialize LCD to 4 or 8 bit I/O mode
   LCD_DDR |= ( _BV(LCD_RS_PIN) |
+#if !LCD_WRITE_ONLY
                _BV(LCD_RW_PIN) |
+#endif
+#if LCD_8BIT
+               _BV(LCD_E_PIN) );
+  LCD_DATA_DDR = LCD_DATA_BITS;
+#else
                _BV(LCD_E_PIN) |
-               _BV(LCD_DATA0_PIN) |
-               _BV(LCD_DATA1_PIN) |
-               _BV(LCD_DATA2_PIN) |
-               _BV(LCD_DATA3_PIN) );
+               LCD_DATA_BITS );
+#endif
 
   _delay_us(16000); //wait 16ms or more after power-on
 
   //initial write to lcd is 8bit
-  LCD_DATA1_PORT |= _BV(LCD_DATA1_PIN);
-  LCD_DATA0_PORT |= _BV(LCD_DATA0_PIN);
+#if LCD_8BIT
+  lcd_set_databus(LCD_FUNCTION_8BIT_1LINE);
+#else
+  lcd_set_databus(lcd_high_nibble(LCD_FUNCTION_8BIT_1LINE));
+#endif
   lcd_e_toggle();
   _delay_us(4992); //delay, busy flag can't be checked here
 
@@ -473,15 +737,22 @@ void lcd_init(uint8_t dispAttr)
   lcd_e_toggle();
   _delay_us(64); //delay, busy flag can't be checked here
 
+#if !LCD_8BIT
   //now configure for 4bit mode
-  LCD_DATA0_PORT &= ~_BV(LCD_DATA0_PIN);
+  lcd_set_databus(lcd_high_nibble(LCD_FUNCTION_4BIT_1LINE));
   lcd_e_toggle();
   _delay_us(64); //some displays need this additional delay
   //from now the LCD only accepts 4 bit I/O, we can use lcd_command()
+#endif
 
+#if LCD_ASYNC
+  lcd_queue_init();
+#endif
   lcd_command(LCD_FUNCTION_DEFAULT);  //function set: display lines
   lcd_command(LCD_DISP_OFF);          //display off
   lcd_clrscr();                       //display clear
   lcd_command(LCD_MODE_DEFAULT);      //set entry mode
   lcd_command(dispAttr);              //display/cursor control
+  //the LCD is ready once that's all been sent
+  lcd_flush();
 }
@@ -37,7 +37,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  added 4-bit I/O mode, improved and optimized code.
 
  Library can be operated in memory mapped mode (LCD_IO_MODE=0) or in
- 4-bit IO port mode (LCD_IO_MODE=1). 8-bit IO port mode not supported.
+ 4-bit IO port mode (LCD_IO_MODE=1). 8-bit IO port mode is selected with
+ LCD_8BIT.
 
  Memory mapped mode compatible with Kanda STK200, but supports also
  generation of R/W signal through A8 address line.
@@ -75,18 +76,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *  Change LCD_RS_PORT, LCD_RW_PORT, LCD_E_PORT if you want the control lines on
  *  different ports.
  *
- *  Normally the four data lines should be mapped to bit 0..3 on one port, but it
- *  is possible to connect these data lines in different order or even on different
- *  ports by adapting the LCD_DATAx_PORT and LCD_DATAx_PIN definitions.
+ *  The four data lines have to be on four pins in a row of LCD_PORT (this is
+ *  checked at compile time), so each nibble is written to the port in one go.
+ *  Bits 0..3 or 4..7 are fastest, since the nibbles don't have to be shifted.
  *
  */
 #define LCD_PORT         PORTA        //port for the LCD lines
 #define LCD_DDR          DDRA         //ddr for the LCD lines
 #define LCD_PIN          PINA         //pin for the LCD lines
-#define LCD_DATA0_PORT   LCD_PORT     //port for 4bit data bit 0
-#define LCD_DATA1_PORT   LCD_PORT     //port for 4bit data bit 1
-#define LCD_DATA2_PORT   LCD_PORT     //port for 4bit data bit 2
-#define LCD_DATA3_PORT   LCD_PORT     //port for 4bit data bit 3
 #define LCD_DATA0_PIN    0            //pin for 4bit data bit 0
 #define LCD_DATA1_PIN    1            //pin for 4bit data bit 1
 #define LCD_DATA2_PIN    2            //pin for 4bit data bit 2
@@ -98,6 +95,47 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define LCD_E_PORT       LCD_PORT     //port for Enable line
 #define LCD_E_PIN        6            //pin  for Enable line
 
+/**
+ *  @name Definitions for 8-bit IO mode
+ *  Set LCD_8BIT to 1 if all eight data lines are connected, to all of
+ *  LCD_DATA_PORT (bit 0 to D0 and so on). Each byte is then sent in a single
+ *  write instead of two nibbles. RS, RW and E stay on LCD_PORT, and
+ *  LCD_DATA0_PIN..LCD_DATA3_PIN aren't used.
+ */
+#define LCD_8BIT            0 //0: 4-bit bus, 1: 8-bit bus
+#define LCD_DATA_PORT    PORTB        //port for the 8bit data lines
+#define LCD_DATA_DDR     DDRB         //ddr for the 8bit data lines
+#define LCD_DATA_PIN     PINB         //pin for the 8bit data lines
+
+/**
+ *  @name Definitions for write-only mode
+ *  Set LCD_WRITE_ONLY to 1 if the RW line is tied to ground. Nothing is read
+ *  back from the LCD then, instead each write waits as long as the LCD takes
+ *  to carry it out (the busy flag is never polled).
+ *  The address counter is kept track of in software either way, so the
+ *  delays are the only difference.
+ */
+#define LCD_WRITE_ONLY      0 //0: poll the busy flag, 1: RW tied to ground
+#define LCD_DELAY_CMD_US   50 //how long most writes take (37us at 270kHz)
+#define LCD_DELAY_CLEAR_US 2000 //how long clear and home take (1.52ms)
+
+/**
+ *  @name Definitions for the write queue
+ *  Set LCD_ASYNC to 1 to have lcd_command() and lcd_data() (and everything
+ *  that uses them) only queue up their writes. Timer2 then sends the queue to
+ *  the LCD in the background, one write every LCD_DELAY_CMD_US, without ever
+ *  reading the busy flag. When the queue is full, the next write waits for
+ *  room, and lcd_flush() waits for all of it to be sent.
+ *  The queue holds a whole frame from lcd_fb_flush, which is at most a write
+ *  per character and one to set the address per line (runs of changes are
+ *  split by gaps, so never more), two for the cursor, and 10 for each of the
+ *  8 CGRAM glyphs it may have to load: 116 writes on 16x2, 166 on 20x4.
+ *  (NOTE: interrupts have to be on for the queue to be sent, even during
+ *   lcd_init)
+ */
+#define LCD_ASYNC           1 //0: wait for each write, 1: queue them
+#define LCD_QUEUE_LEN      (LCD_LINES*(LCD_DISP_LENGTH+1) + 2 + 8*10)
+
 /**
  *  @name Definitions for LCD command instructions
  *  The constants define the various LCD controller instructions which can be passed to the
@@ -213,6 +251,18 @@ extern void lcd_puts(const char *s);
 */
 extern void lcd_puts_p(const char *progmem_s);
 
+/**
+ @brief    Display a run of characters, setting the address only once
+ Nothing in the run is interpreted (not even LF), and it isn't wrapped at the
+ end of the line, so it has to fit on it.
+ @param    x horizontal position of the first character\n (0: left most position)
+ @param    y vertical position\n   (0: first line)
+ @param    s characters to be displayed
+ @param    len how many characters there are
+ @return   none
+*/
+extern void lcd_write_block(uint8_t x, uint8_t y, const char *s, uint8_t len);
+
 /**
  @brief    Load a custom glyph into CGRAM
  @param    glyph a glyph from program memory be be loaded
@@ -221,6 +271,14 @@ extern void lcd_puts_p(const char *progmem_s);
 */
 extern void lcd_load_glyph(const unsigned char* PROGMEM glyph, uint8_t slot);
 
+/**
+ @brief    Wait until every queued write has been sent to the LCD
+ Does nothing unless LCD_ASYNC is set.
+ @param    void
+ @return   none
+*/
+extern void lcd_flush(void);
+
 /**
  @brief    Send LCD controller instruction command
  @param    cmd instruction to send to LCD controller, see HD44780 data sheet
@@ -20,126 +20,166 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ***/
 
-#include <util/delay.h>
 #include <avr/pgmspace.h> //for program space storage
 #include <stdio.h> //for sprintf and NULL
-#include <stdlib.h> //for atof and such
-#include <string.h> //for cstring processing
+#include <stdlib.h> //for atoi
 #include "lcd_extras.h"
-#include "keypad.h" //for keypad input
+#include "nmea.h" //for nmea_parse_fixed
+#include "coord_dist.h" //for COORD_PER_DEG
 #include "keys.h"
-#include "lcd.h" //for LCD output
+#include "lcd_fb.h" //for drawing to the LCD
 
 //constants
 static const uint8_t SMALL_BUF_LEN = 17;
 
 //data stored in program memory
 //user input prompt text
-static const char PROGMEM UI_SIGN_PROMPT[] = "   1) Neg 3) Pos";
-static const char PROGMEM UI_NUM_PROMPT[] = "#:";
+static const char PROGMEM UI_SIGN_PROMPT[] = "1)Neg 3)Pos";
 
-//blanks a line on the display
-//  uint8_t row - the row to blank
-void lcd_clearline(uint8_t row){
-  uint8_t i;
+//draws a fixed point coordinate in decimal degrees
+//  int32_t val - the coordinate to write, in units of 1e-7 degrees
+void print_coord(int32_t val){
+  char small_buffer[SMALL_BUF_LEN];
+  char sign = ' ';
 
-  lcd_gotoxy(0, row);
-  for(i=0; i<LCD_DISP_LENGTH; i++){
-    lcd_putc(' ');
+  if( val < 0 ){
+    sign = '-';
+    val = -val;
   }
-  lcd_gotoxy(0, row);
-}
-
-//writes a float to the lcd
-//  float val - the floating point value to write
-void print_float(float val){
-  char small_buffer[SMALL_BUF_LEN];
 
   sprintf_P( small_buffer,
-             PSTR("%f"), val );
+             PSTR("%c%ld.%07ld"), sign,
+             (long)(val/COORD_PER_DEG), (long)(val%COORD_PER_DEG) );
 
-  lcd_puts(small_buffer);
+  lcd_fb_puts(small_buffer);
 }
 
-//get a string of null-terminated input from the keypad
-//  char* str - the string buffer to write to
-//  uint8_t maxlen - the maximum length of the string buffer
-void prompt_getln( char* str, uint8_t maxlen ){
-  uint8_t i = 0;
-  char curr = NO_BUTTON;
-  char prev = NO_BUTTON;
-
-  //while "enter" hasn't been pressed and we're withing buffer limits
-  while( (curr != ENTER_BUTTON) && (i < (maxlen-1)) ){
-    curr = keypad_getchar();
-
-    //make sure the keys have only been pressed this loop
-    if( (curr != prev) && (curr != NO_BUTTON) ){
-      lcd_putc(curr);
-      str[i] = curr;
-      i++;
-    }
+//starts a prompt over
+//  prompt_t* p - the prompt
+//  uint8_t with_sign - 1 to ask for a sign first (for coordinates), 0
+//    otherwise
+void prompt_start(prompt_t* p, uint8_t with_sign){
+  p->len = 0;
+  p->buf[0] = '\0';
+  p->sign = '\0';
+  p->state = with_sign ? PROMPT_SIGN : PROMPT_DIGITS;
+}
 
-    prev = curr;
-  }
+//gives a prompt a key that was pressed
+//  prompt_t* p - the prompt
+//  char key - the key (NO_BUTTON does nothing)
+//  returns uint8_t - 1 once the input has been entered, 0 otherwise
+uint8_t prompt_key(prompt_t* p, char key){
+  uint8_t result = 0;
 
-  str[i] = '\0'; //terminate the string
-}
+  if( key == NO_BUTTON ){
+    return 0;
+  }
 
-//retrieves a floating point number from the user via the keypad and LCD
-//  returns float - the value entered by the user
-float prompt_float(){
-  char small_buffer[SMALL_BUF_LEN];
-  char ch;
-  float result;
+  if( p->state == PROMPT_SIGN ){
+    //only the sign keys do anything until there's a sign
+    if( key == '1' ){
+      p->sign = '-';
+      p->state = PROMPT_DIGITS;
+    } else if( key == '3' ){
+      p->sign = '+';
+      p->state = PROMPT_DIGITS;
+    }
+  } else if( p->state == PROMPT_DIGITS ){
+    if( key == ENTER_BUTTON ){
+      p->state = PROMPT_DONE;
+    } else {
+      p->buf[p->len] = key;
+      (p->len)++;
+      p->buf[p->len] = '\0';
+
+      //there's no room for more, so that's all of it
+      if( p->len == PROMPT_LEN ){
+        p->state = PROMPT_DONE;
+      }
+    }
 
-  lcd_clrscr();
+    result = (p->state == PROMPT_DONE);
+  }
 
-  //prompt for sign
-  lcd_puts_p(UI_SIGN_PROMPT);
-  lcd_gotoxy( 0,0 );
-  lcd_command(LCD_DISP_ON_CURSOR_BLINK); //turn on the blinking cursor
-  //wait until the proper key is pressed
-  do {
-    ch = keypad_getchar();
-  } while( (ch != '1') && (ch != '3') );
-  lcd_putc(ch);
+  return result;
+}
 
-  //wait for keys to be released
-  while( keypad_getchar() != NO_BUTTON ){ }
+//draws a prompt on a row, leaving the cursor where the next character goes
+//  (NOTE: turn the cursor on to show it)
+//  const prompt_t* p - the prompt
+//  const char* PROGMEM label - what's being asked for, e.g. "La"
+//  uint8_t col - the column to draw the prompt at
+//  uint8_t row - the row to draw the prompt on
+void prompt_draw(const prompt_t* p, const char* PROGMEM label, uint8_t col,
+                 uint8_t row){
+  lcd_fb_gotoxy(col, row);
+  lcd_fb_puts_p(label);
+  lcd_fb_putc(' ');
+
+  if( p->state == PROMPT_SIGN ){
+    lcd_fb_puts_p(UI_SIGN_PROMPT);
+  } else {
+    if( p->sign != '\0' ){
+      lcd_fb_putc(p->sign);
+    }
+    lcd_fb_puts(p->buf);
+  }
+}
 
-  //prompt for digits
-  lcd_gotoxy( 0,1 );
-  lcd_puts_p(UI_NUM_PROMPT);
-  prompt_getln( small_buffer, SMALL_BUF_LEN );
+//gets the coordinate that was entered into a prompt
+//  const prompt_t* p - the prompt
+//  uint8_t max_deg - the furthest it can be from 0, 90 for a latitude or 180
+//    for a longitude
+//  int32_t* coord - where to store the coordinate, in units of 1e-7 degrees
+//  returns uint8_t - 1 if it's a coordinate in range, 0 if it isn't a number
+//    or is out of range (coord is left alone then)
+uint8_t prompt_coord(const prompt_t* p, uint8_t max_deg, int32_t* coord){
+  const char* c = p->buf;
+  uint16_t whole = 0;
+  uint8_t digits = 0;
+  int32_t result;
+
+  //the whole degrees are checked as they come in, so no entry is long enough
+  // to overflow...
+  while( (*c >= '0') && (*c <= '9') ){
+    whole = whole*10 + (*c - '0');
+    if( whole > max_deg ){
+      return 0;
+    }
+    digits++;
+    c++;
+  }
+  //...and the rest can only be a point and decimals
+  if( *c == '.' ){
+    c++;
+    while( (*c >= '0') && (*c <= '9') ){
+      digits++;
+      c++;
+    }
+  }
+  if( (*c != '\0') || (digits == 0) ){
+    return 0;
+  }
 
-  //store the value
-  result = atof( small_buffer );
+  //(7 decimals is 1e-7 degrees, any more are cut off)
+  result = nmea_parse_fixed( p->buf, 7 );
+  if( result > (int32_t)max_deg*COORD_PER_DEG ){
+    return 0;
+  }
 
   //if the user said this was a negative number...
-  if( ch == '1' ){
+  if( p->sign == '-' ){
     result = -result;
   }
 
-  lcd_command(LCD_DISP_ON); //turn the cursor back off
-  lcd_clrscr();
-
-  return result;
+  *coord = result;
+  return 1;
 }
 
-//prompts the user for an integer
-//  uint8_t row - the row to draw the prompt on
-//  returns uint16_t - the value entered
-uint16_t prompt_uint16(uint8_t row){
-  char small_buffer[SMALL_BUF_LEN];
-
-  //wait for keys to be released before accepting input
-  while(keypad_getchar() != NO_BUTTON) {}
-
-  lcd_clearline(row);
-  lcd_gotoxy(0, row);
-  lcd_puts_p(UI_NUM_PROMPT);
-  prompt_getln( small_buffer, SMALL_BUF_LEN );
-
-  return (uint16_t)atoi(small_buffer);
+//gets the integer that was entered into a prompt
+//  const prompt_t* p - the prompt
+//  returns uint16_t - the integer
+uint16_t prompt_uint16(const prompt_t* p){
+  return (uint16_t)atoi(p->buf);
 }
@@ -25,26 +25,61 @@ SOFTWARE.
 
 #include <inttypes.h> //for uint16_t, uint8_t
 
-//blanks a line on the display
-//  uint8_t row - the row to blank
-void lcd_clearline(uint8_t row);
+//draws a fixed point coordinate in decimal degrees
+//  int32_t val - the coordinate to write, in units of 1e-7 degrees
+void print_coord(int32_t val);
 
-//writes a float to the lcd
-//  float val - the floating point value to write
-void print_float(float val);
+//longest input a prompt takes, enough for a coordinate like "177.1234567"
+#define PROMPT_LEN 11
 
-//get a string of null-terminated input from the keypad
-//  char* str - the string buffer to write to
-//  uint8_t maxlen - the maximum length of the string buffer
-void prompt_getln( char* str, uint8_t maxlen );
+//what a prompt is waiting for
+#define PROMPT_SIGN   0 //a sign key, 1 for negative and 3 for positive
+#define PROMPT_DIGITS 1 //the digits, ended by the enter key
+#define PROMPT_DONE   2 //nothing, it's been entered
 
-//retrieves a floating point number from the user via the keypad and LCD
-//  returns float - the value entered by the user
-float prompt_float();
+//a line of input typed in on the keypad, one key at a time so nothing has to
+//wait for the user
+struct prompt {
+  char buf[PROMPT_LEN+1]; //the digits typed so far, NULL-terminated
+  uint8_t len;            //how many digits that is
+  char sign;              //'-' or '+' once it's chosen, NULL if there isn't one
+  uint8_t state;          //one of the PROMPT_* states
+};
+typedef struct prompt prompt_t;
 
-//prompts the user for an integer
+//starts a prompt over
+//  prompt_t* p - the prompt
+//  uint8_t with_sign - 1 to ask for a sign first (for coordinates), 0
+//    otherwise
+void prompt_start(prompt_t* p, uint8_t with_sign);
+
+//gives a prompt a key that was pressed
+//  prompt_t* p - the prompt
+//  char key - the key (NO_BUTTON does nothing)
+//  returns uint8_t - 1 once the input has been entered, 0 otherwise
+uint8_t prompt_key(prompt_t* p, char key);
+
+//draws a prompt on a row, leaving the cursor where the next character goes
+//  (NOTE: turn the cursor on to show it)
+//  const prompt_t* p - the prompt
+//  const char* PROGMEM label - what's being asked for, e.g. "La"
+//  uint8_t col - the column to draw the prompt at
 //  uint8_t row - the row to draw the prompt on
-//  returns uint16_t - the value entered
-uint16_t prompt_uint16(uint8_t row);
+void prompt_draw(const prompt_t* p, const char* PROGMEM label, uint8_t col,
+                 uint8_t row);
+
+//gets the coordinate that was entered into a prompt
+//  const prompt_t* p - the prompt
+//  uint8_t max_deg - the furthest it can be from 0, 90 for a latitude or 180
+//    for a longitude
+//  int32_t* coord - where to store the coordinate, in units of 1e-7 degrees
+//  returns uint8_t - 1 if it's a coordinate in range, 0 if it isn't a number
+//    or is out of range (coord is left alone then)
+uint8_t prompt_coord(const prompt_t* p, uint8_t max_deg, int32_t* coord);
+
+//gets the integer that was entered into a prompt
+//  const prompt_t* p - the prompt
+//  returns uint16_t - the integer
+uint16_t prompt_uint16(const prompt_t* p);
 
 #endif
@@ -0,0 +1,156 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#include <avr/pgmspace.h> //for pgm_read_byte
+#include "lcd_fb.h"
+#include "lcd.h" //for LCD output
+
+//what's being drawn, and what the LCD shows now
+static char lcd_fb_next[LCD_FB_LINES][LCD_FB_LENGTH];
+static char lcd_fb_shown[LCD_FB_LINES][LCD_FB_LENGTH];
+//where the next character is drawn (x can be past the end of the line, then
+// nothing is)
+static uint8_t lcd_fb_x = 0;
+static uint8_t lcd_fb_y = 0;
+//whether the cursor should be shown, and whether it is (0xFF if unknown)
+static uint8_t lcd_fb_cursor_on = 0;
+static uint8_t lcd_fb_cursor_shown = 0xFF;
+
+//clears the LCD and its copy
+//  (NOTE: call this after lcd_init)
+void lcd_fb_init(){
+  uint8_t row, col;
+
+  lcd_clrscr();
+  for(row=0; row<LCD_FB_LINES; row++){
+    for(col=0; col<LCD_FB_LENGTH; col++){
+      lcd_fb_next[row][col] = ' ';
+      lcd_fb_shown[row][col] = ' ';
+    }
+  }
+  lcd_fb_x = 0;
+  lcd_fb_y = 0;
+}
+
+//blanks the copy of the screen, and moves to the top left corner
+void lcd_fb_clrscr(){
+  uint8_t row;
+
+  for(row=0; row<LCD_FB_LINES; row++){
+    lcd_fb_clearline(row);
+  }
+  lcd_fb_y = 0;
+}
+
+//blanks a line of the copy of the screen, and moves to the start of it
+//  uint8_t row - the row to blank
+void lcd_fb_clearline(uint8_t row){
+  uint8_t col;
+
+  for(col=0; col<LCD_FB_LENGTH; col++){
+    lcd_fb_next[row][col] = ' ';
+  }
+  lcd_fb_gotoxy(0, row);
+}
+
+//moves to where the next character is drawn
+//  uint8_t x - the column (0 is the left most)
+//  uint8_t y - the row (0 is the first line)
+void lcd_fb_gotoxy(uint8_t x, uint8_t y){
+  lcd_fb_x = x;
+  lcd_fb_y = y % LCD_FB_LINES;
+}
+
+//draws a character, and moves to the right of it
+//  char c - the character, "\n" moves to the start of the next line
+void lcd_fb_putc(char c){
+  if( c == '\n' ){
+    lcd_fb_gotoxy(0, lcd_fb_y+1);
+  } else if( lcd_fb_x < LCD_FB_LENGTH ){
+    lcd_fb_next[lcd_fb_y][lcd_fb_x] = c;
+    lcd_fb_x++;
+  }
+}
+
+//draws a string
+//  const char* s - the string
+void lcd_fb_puts(const char* s){
+  char c;
+
+  while( (c = *s++) ){
+    lcd_fb_putc(c);
+  }
+}
+
+//draws a string from program memory
+//  const char* PROGMEM s - the string
+void lcd_fb_puts_p(const char* PROGMEM s){
+  char c;
+
+  while( (c = pgm_read_byte(s++)) ){
+    lcd_fb_putc(c);
+  }
+}
+
+//sets whether the blinking cursor is shown (it's put wherever drawing
+//stopped, once the screen is flushed)
+//  uint8_t on - 1 to show it, 0 to hide it
+void lcd_fb_cursor(uint8_t on){
+  lcd_fb_cursor_on = on;
+}
+
+//sends the LCD the characters that changed, moving its address only where
+//there's a gap between them
+void lcd_fb_flush(){
+  uint8_t row, col, len;
+
+  for(row=0; row<LCD_FB_LINES; row++){
+    col = 0;
+    while( col < LCD_FB_LENGTH ){
+      //find the next run of changes...
+      len = 0;
+      while( ((col+len) < LCD_FB_LENGTH) &&
+             (lcd_fb_next[row][col+len] != lcd_fb_shown[row][col+len]) ){
+        lcd_fb_shown[row][col+len] = lcd_fb_next[row][col+len];
+        len++;
+      }
+
+      //...and send it from a single address
+      if( len ){
+        lcd_write_block(col, row, &lcd_fb_next[row][col], len);
+        col += len;
+      } else {
+        col++;
+      }
+    }
+  }
+
+  if( lcd_fb_cursor_on ){
+    //(the cursor can't go past the end of the line)
+    lcd_gotoxy( (lcd_fb_x < LCD_FB_LENGTH) ? lcd_fb_x : LCD_FB_LENGTH-1,
+                lcd_fb_y );
+  }
+  if( lcd_fb_cursor_on != lcd_fb_cursor_shown ){
+    lcd_command( lcd_fb_cursor_on ? LCD_DISP_ON_CURSOR_BLINK : LCD_DISP_ON );
+    lcd_fb_cursor_shown = lcd_fb_cursor_on;
+  }
+}
@@ -0,0 +1,79 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#ifndef __LCD_FB_H
+#define __LCD_FB_H
+
+#include <inttypes.h>
+#include <avr/pgmspace.h> //for PSTR
+#include "lcd.h" //for LCD_LINES and LCD_DISP_LENGTH
+
+//The screen is drawn into a copy of it in RAM, and lcd_fb_flush sends the
+//LCD only the characters that changed since it was last flushed. Drawing is
+//the same as with lcd.h (but past the end of a line is cut off), so a whole
+//screen can be redrawn every time without it flickering or tying up the LCD.
+
+//the size of the copy comes from lcd.h
+#define LCD_FB_LINES LCD_LINES
+#define LCD_FB_LENGTH LCD_DISP_LENGTH
+
+//clears the LCD and its copy
+//  (NOTE: call this after lcd_init)
+void lcd_fb_init();
+
+//blanks the copy of the screen, and moves to the top left corner
+void lcd_fb_clrscr();
+
+//blanks a line of the copy of the screen, and moves to the start of it
+//  uint8_t row - the row to blank
+void lcd_fb_clearline(uint8_t row);
+
+//moves to where the next character is drawn
+//  uint8_t x - the column (0 is the left most)
+//  uint8_t y - the row (0 is the first line)
+void lcd_fb_gotoxy(uint8_t x, uint8_t y);
+
+//draws a character, and moves to the right of it
+//  char c - the character, "\n" moves to the start of the next line
+void lcd_fb_putc(char c);
+
+//draws a string
+//  const char* s - the string
+void lcd_fb_puts(const char* s);
+
+//draws a string from program memory
+//  const char* PROGMEM s - the string
+void lcd_fb_puts_p(const char* PROGMEM s);
+
+//draws a string constant, kept in program memory
+#define lcd_fb_puts_P(__s) lcd_fb_puts_p(PSTR(__s))
+
+//sets whether the blinking cursor is shown (it's put wherever drawing
+//stopped, once the screen is flushed)
+//  uint8_t on - 1 to show it, 0 to hide it
+void lcd_fb_cursor(uint8_t on);
+
+//sends the LCD the characters that changed, moving its address only where
+//there's a gap between them
+void lcd_fb_flush();
+
+#endif
@@ -0,0 +1,95 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#include <stdio.h> //for NULL
+#include "lcd_glyph.h"
+#include "lcd.h" //for lcd_load_glyph
+
+//how long ago a slot was drawn, in frames (it saturates)
+static const uint8_t __LCD_GLYPH_NEVER = 0xFF;
+
+//a CGRAM slot
+struct lcd_glyph_slot {
+  const uint8_t* glyph; //the glyph that's loaded, NULL if none is
+  uint8_t age;          //how many frames ago it was drawn, 0 if it's on the
+                        // screen now
+};
+
+static struct lcd_glyph_slot lcd_glyph_slots[LCD_GLYPH_SLOTS];
+
+//forgets what's in CGRAM
+//  (NOTE: call this after lcd_init)
+void lcd_glyph_init(){
+  uint8_t i;
+
+  for(i=0; i<LCD_GLYPH_SLOTS; i++){
+    lcd_glyph_slots[i].glyph = NULL;
+    lcd_glyph_slots[i].age = __LCD_GLYPH_NEVER;
+  }
+}
+
+//starts a new frame, so the glyphs that were on the screen can be replaced
+void lcd_glyph_frame(){
+  uint8_t i;
+
+  for(i=0; i<LCD_GLYPH_SLOTS; i++){
+    if( lcd_glyph_slots[i].age != __LCD_GLYPH_NEVER ){
+      (lcd_glyph_slots[i].age)++;
+    }
+  }
+}
+
+//gets the character to draw a glyph with, loading it into CGRAM if it isn't
+//already
+//  const uint8_t* PROGMEM glyph - the glyph, LCD_GLYPH_SIZE rows of 5 pixels
+//  char fallback - what to draw instead if every slot is on the screen
+//  returns char - the character to draw
+char lcd_glyph(const uint8_t* PROGMEM glyph, char fallback){
+  uint8_t i;
+  uint8_t oldest = LCD_GLYPH_SLOTS;
+
+  for(i=0; i<LCD_GLYPH_SLOTS; i++){
+    if( lcd_glyph_slots[i].glyph == glyph ){
+      lcd_glyph_slots[i].age = 0;
+      return i;
+    }
+
+    //(the slots that are empty are the oldest of all)
+    if( (lcd_glyph_slots[i].age != 0) &&
+        ( (oldest == LCD_GLYPH_SLOTS) ||
+          (lcd_glyph_slots[i].age > lcd_glyph_slots[oldest].age) ) ){
+      oldest = i;
+    }
+  }
+
+  if( oldest == LCD_GLYPH_SLOTS ){
+    return fallback;
+  }
+
+  //CGRAM is only written when a glyph isn't there already (anything on the
+  // screen in that slot changes with it, but it's being redrawn anyway)
+  lcd_load_glyph(glyph, oldest);
+  lcd_glyph_slots[oldest].glyph = glyph;
+  lcd_glyph_slots[oldest].age = 0;
+
+  return oldest;
+}
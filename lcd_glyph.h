@@ -0,0 +1,51 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#ifndef __LCD_GLYPH_H
+#define __LCD_GLYPH_H
+
+#include <inttypes.h>
+#include <avr/pgmspace.h> //for PROGMEM
+
+//The LCD only has room for 8 custom glyphs (in CGRAM), so they're loaded as
+//they're drawn. A glyph stays loaded until its slot is needed for another
+//one, and then the one that was drawn the longest ago goes. Glyphs drawn in
+//the current frame are never replaced, since they're on the screen.
+
+//how many glyphs fit in CGRAM
+#define LCD_GLYPH_SLOTS 8
+
+//forgets what's in CGRAM
+//  (NOTE: call this after lcd_init)
+void lcd_glyph_init();
+
+//starts a new frame, so the glyphs that were on the screen can be replaced
+void lcd_glyph_frame();
+
+//gets the character to draw a glyph with, loading it into CGRAM if it isn't
+//already
+//  const uint8_t* PROGMEM glyph - the glyph, LCD_GLYPH_SIZE rows of 5 pixels
+//  char fallback - what to draw instead if every slot is on the screen
+//  returns char - the character to draw
+char lcd_glyph(const uint8_t* PROGMEM glyph, char fallback);
+
+#endif
@@ -21,37 +21,125 @@ SOFTWARE.
 ***/
 
 #include <inttypes.h>
+#include <avr/interrupt.h>
 #include "uart.h"
 #include "gps.h"
 #include "keypad.h"
-#include "lcd.h"
+#include "lcd_fb.h"
+#include "sched.h"
 #include "storage.h"
+#include "tick.h"
 #include "ui.h"
 
 //the slot of EEPROM that stores the location of "home"
 static const uint16_t HOME_SLOT = 0;
 
+//how often each task runs, in milliseconds (the UART buffers 255 bytes from
+// the GPS, 22ms at 115200 baud)
+static const uint16_t GPS_PERIOD = 2;
+//(the keypad queues up to 8 key events, see keypad.c)
+static const uint16_t INPUT_PERIOD = 20;
+//(the display is redrawn this often between updates from the GPS, and right
+// away when one comes in)
+static const uint16_t DISPLAY_PERIOD = 200;
+static const uint16_t STORAGE_PERIOD = 5;
+//how long each task should take at most, in microseconds (see sched.h)
+//  (the GPS task can be kept waiting while all the others run back to back,
+//   so theirs add up to 17.2ms, well inside what the UART can buffer)
+static const uint16_t GPS_BUDGET = 2000;
+static const uint16_t INPUT_BUDGET = 2000;
+static const uint16_t DISPLAY_BUDGET = 15000;
+static const uint16_t STORAGE_BUDGET = 200;
+
+//struct for storing state
+static loc_state_t loc;
+//when the last update came in
+static uint32_t update_time = 0;
+//1 once there's been an update, 2 if the display hasn't shown it yet
+static uint8_t updated = 0;
+//1 if a key changed what's on the display
+static uint8_t redraw = 0;
+//the display's task number, so a new update can wake it
+static uint8_t display_task_num;
+
+//parses whatever the GPS has sent
+void gps_task(){
+  if( gps_poll(&loc) ){
+    update_time = tick_ms();
+    updated = 2;
+    sched_wake(display_task_num);
+  }
+}
+
+//takes keys for the display
+void input_task(){
+  if( ui_input(&loc) ){
+    redraw = 1;
+    sched_wake(display_task_num);
+  }
+}
+
+//redraws the display
+void display_task(){
+  //a new update is shown (and keys are taken) right away...
+  if( updated == 2 ){
+    updated = 1;
+    ui_update(&loc);
+  }
+  //...and in between updates, the numbers keep moving with where we should be
+  // by now
+  else if( updated ){
+    gps_predict(&loc, tick_ms() - update_time);
+    ui_redraw(&loc);
+  }
+  //...and keys are shown even before there's been one
+  else if( redraw ){
+    ui_redraw(&loc);
+  }
+
+  redraw = 0;
+}
+
 void init(){
   //initialize hardware
   keypad_init();
-  gps_init();
+  tick_init();
+
+  //the UART, keypad and tick run in the background from here on (gps_init
+  // needs the UART to hear the GPS)
+  sei();
+
+  //the display comes up first, so it isn't blank while the GPS is found and
+  // set up (which takes a few seconds)
   ui_init();
+  lcd_fb_puts_P("Setting up GPS");
+  lcd_fb_flush();
+
+  //a GPS that didn't take its settings may still send what we need, so carry
+  // on either way, but say so
+  lcd_fb_clrscr();
+  if( gps_init() ){
+    lcd_fb_puts_P("Waiting for GPS\ndata...");
+  } else {
+    lcd_fb_puts_P("GPS setup failed\nWaiting for data");
+  }
+  lcd_fb_flush();
+
+  //the GPS comes first, so it's never kept waiting by the others
+  sched_add(gps_task, GPS_PERIOD, GPS_BUDGET);
+  sched_add(input_task, INPUT_PERIOD, INPUT_BUDGET);
+  display_task_num = sched_add(display_task, DISPLAY_PERIOD, DISPLAY_BUDGET);
+  sched_add(storage_task, STORAGE_PERIOD, STORAGE_BUDGET);
 }
 
 int main(){
-  //struct for storing state
-  loc_state_t loc;
+  //(slots saved by older firmware are converted before they're read)
+  storage_init();
   read_dest(HOME_SLOT, &loc);
 
   init();
 
-  lcd_clrscr();
-  lcd_puts_P("Waiting for GPS\ndata...");
-
-  for(;;){
-    gps_update(&loc);
-    ui_update(&loc);
-  }
+  sched_run();
 
   return 0;
 }
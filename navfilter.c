@@ -0,0 +1,150 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#include <inttypes.h>
+#include "navfilter.h"
+#include "coord_dist.h" //for coord_delta_long
+#include "trig.h"
+
+//how much of the difference between a fix and where the filter expected it to
+// be goes into the position (alpha) and the velocity (beta), in 1/256ths
+static const int16_t __NAV_ALPHA = 128;
+static const int16_t __NAV_BETA = 32;
+//how much of the difference between the GPS's track angle and the heading goes
+// into the heading, in 1/256ths
+static const int16_t __NAV_HEADING_ALPHA = 96;
+//how far (in 1e-7 degrees, about 1km) a fix can be from where it was expected
+// before the filter starts over from it (this also keeps the math in 32 bits)
+static const int32_t __NAV_RESET_DIST = 90000;
+//how many fixes to keep coasting for
+#define NAV_COAST_FIXES (NAV_COAST_TIME*GPS_FIX_RATE)
+//centimeters per 1e-7 degrees of latitude, in 1/256ths (1.112cm)
+#define NAV_CM_PER_COORD 285
+
+//resets a filter so the next fix starts it over
+//  navfilter_t* nav - the filter to reset
+void navfilter_init(navfilter_t* nav){
+  nav->vel_lat = 0;
+  nav->vel_lon = 0;
+  nav->course = 0;
+  nav->heading = 0;
+  nav->state = NAV_NONE;
+  nav->coast = 0;
+}
+
+//converts a filter velocity to centimeters per second
+//  int32_t vel - the velocity, in 1/16ths of 1e-7 degrees per fix (of
+//    latitude, or of longitude already scaled by the cosine of the latitude)
+//  returns int16_t - the velocity in centimeters per second
+static int16_t nav_vel_to_cm(int32_t vel){
+  return (vel*GPS_FIX_RATE*NAV_CM_PER_COORD) >> 12;
+}
+
+//runs a filter on a new update, every update whether it has a fix or not
+//  (NOTE: takes the same number of steps every time, there are no loops)
+//  navfilter_t* nav - the filter
+//  loc_state_t* loc - the update from the GPS, its position and heading are
+//    replaced with the smoothed ones, and its velocity and nav are set
+void navfilter_update(navfilter_t* nav, loc_state_t* loc){
+  //where the velocity says we should be by now
+  int32_t lat = nav->lat + ((nav->vel_lat + 8) >> 4);
+  int32_t lon = coord_delta_long( 0, nav->lon + ((nav->vel_lon + 8) >> 4) );
+  int32_t dlat, dlon;
+  uint32_t speed2;
+  angle_t track;
+  uint8_t fresh = 0;
+
+  if( loc->fix ){
+    //how far off that is
+    dlat = loc->curr_lat - lat;
+    dlon = coord_delta_long(lon, loc->curr_long);
+
+    //if there's nothing to go on, or the fix jumped (the GPS was off, or
+    // coasting went the wrong way), start over from it
+    if( (nav->state == NAV_NONE) ||
+        (dlat > __NAV_RESET_DIST) || (dlat < -__NAV_RESET_DIST) ||
+        (dlon > __NAV_RESET_DIST) || (dlon < -__NAV_RESET_DIST) ){
+      nav->lat = loc->curr_lat;
+      nav->lon = loc->curr_long;
+      nav->vel_lat = 0;
+      nav->vel_lon = 0;
+      fresh = 1;
+    } else {
+      //otherwise meet the fix partway, and learn from the difference
+      nav->lat = lat + ((__NAV_ALPHA*dlat) >> 8);
+      nav->lon = coord_delta_long( 0, lon + ((__NAV_ALPHA*dlon) >> 8) );
+      nav->vel_lat += (__NAV_BETA*dlat) >> 4;
+      nav->vel_lon += (__NAV_BETA*dlon) >> 4;
+    }
+
+    nav->state = NAV_TRACKING;
+    nav->coast = NAV_COAST_FIXES;
+  } else if( (nav->state != NAV_NONE) && (nav->coast > 0) ){
+    //no fix, so keep going the way we were
+    nav->lat = lat;
+    nav->lon = lon;
+    nav->state = NAV_COASTING;
+    (nav->coast)--;
+  } else {
+    //coasting this long is just guessing, so stay put until there's a fix
+    nav->vel_lat = 0;
+    nav->vel_lon = 0;
+    nav->state = NAV_NONE;
+  }
+
+  //work out the velocity on the ground (a degree of longitude gets shorter
+  // away from the equator)
+  (loc->vel_north) = nav_vel_to_cm(nav->vel_lat);
+  (loc->vel_east) = nav_vel_to_cm(
+    trig_mul( nav->vel_lon, trig_cos(trig_coord_to_angle(nav->lat)) ) );
+  speed2 = (int32_t)(loc->vel_north)*(loc->vel_north) +
+           (int32_t)(loc->vel_east)*(loc->vel_east);
+
+  //the GPS's track angle is good when we're moving fast enough, but it jitters
+  // from fix to fix, so meet it partway (the difference is taken as a signed
+  // angle, so it goes the short way around through north)...
+  if( loc->fix && (speed2 >= (uint32_t)NAV_TRACK_SPEED*NAV_TRACK_SPEED) ){
+    track = trig_coord_to_angle( (int32_t)( (loc->heading > 180) ?
+      (loc->heading - 360) : loc->heading ) * COORD_PER_DEG );
+    if( fresh ){
+      nav->course = track;
+    } else {
+      nav->course += ( (int32_t)(track - nav->course) >> 8 ) *
+                     __NAV_HEADING_ALPHA;
+    }
+  }
+  //...otherwise use the way the position is going, as long as it's going
+  // somewhere (the velocity is already smoothed)
+  else if( (nav->state != NAV_NONE) &&
+           (speed2 >= (uint32_t)NAV_STILL_SPEED*NAV_STILL_SPEED) ){
+    nav->course = trig_atan2(loc->vel_east, loc->vel_north);
+  }
+  nav->heading = trig_angle_to_deg(nav->course);
+  if( nav->heading < 0 ){
+    nav->heading += 360;
+  }
+
+  (loc->curr_lat) = nav->lat;
+  (loc->curr_long) = nav->lon;
+  (loc->heading) = nav->heading;
+  (loc->nav) = nav->state;
+}
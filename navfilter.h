@@ -0,0 +1,68 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#ifndef __NAVFILTER_H
+#define __NAVFILTER_H
+
+#include <inttypes.h>
+#include "gps.h" //for loc_state_t and GPS_FIX_RATE
+#include "trig.h" //for angle_t
+
+//what the filter is doing (see loc_state_t's nav)
+#define NAV_NONE     0 //no fix yet, or coasted for too long
+#define NAV_TRACKING 1 //following the fixes
+#define NAV_COASTING 2 //the fix dropped out, dead reckoning from the velocity
+
+//how long to keep dead reckoning after the fix drops out, in seconds
+#define NAV_COAST_TIME 5
+
+//speeds (in centimeters per second) below which the GPS's track angle is too
+//noisy to use, so the heading comes from how the position moves instead...
+#define NAV_TRACK_SPEED 150
+//...and below which even that is noise, so the heading is held
+#define NAV_STILL_SPEED 30
+
+//a constant velocity (alpha-beta) filter for the position
+//  (NOTE: velocity is in units of 1/16th of 1e-7 degrees per fix, so it
+//   doesn't round away at walking speed)
+struct navfilter {
+  int32_t lat, lon;         //the smoothed position, in units of 1e-7 degrees
+  int32_t vel_lat, vel_lon; //the velocity (see above)
+  angle_t course;           //the smoothed heading, as a binary angle
+  int16_t heading;          //the same, in whole degrees 0 to 359
+  uint8_t state;            //one of the NAV_* states
+  uint8_t coast;            //fixes left before coasting gives up
+};
+typedef struct navfilter navfilter_t;
+
+//resets a filter so the next fix starts it over
+//  navfilter_t* nav - the filter to reset
+void navfilter_init(navfilter_t* nav);
+
+//runs a filter on a new update, every update whether it has a fix or not
+//  (NOTE: takes the same number of steps every time, there are no loops)
+//  navfilter_t* nav - the filter
+//  loc_state_t* loc - the update from the GPS, its position and heading are
+//    replaced with the smoothed ones, and its velocity and nav are set
+void navfilter_update(navfilter_t* nav, loc_state_t* loc);
+
+#endif
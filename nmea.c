@@ -0,0 +1,304 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#include <inttypes.h>
+#include <stddef.h> //for NULL
+#include <avr/pgmspace.h> //for program space storage
+#include "nmea.h"
+
+//what an out of range field looks like
+static const char nmea_no_field[] = "";
+
+//checks if a character ends a field
+static inline uint8_t nmea_is_delim(char ch){
+  return (ch == ',') || (ch == '*') || (ch == '\0');
+}
+
+//checks if a character is a decimal digit
+static inline uint8_t nmea_is_digit(char ch){
+  return (ch >= '0') && (ch <= '9');
+}
+
+//decodes a hexadecimal digit
+//  returns uint8_t - the value, or 0xFF if ch isn't a hexadecimal digit
+static uint8_t nmea_hex(char ch){
+  if( nmea_is_digit(ch) ){
+    return ch - '0';
+  } else if( (ch >= 'A') && (ch <= 'F') ){
+    return ch - 'A' + 0x0A;
+  } else if( (ch >= 'a') && (ch <= 'f') ){
+    return ch - 'a' + 0x0A;
+  }
+
+  return 0xFF;
+}
+
+//resets a parser so it waits for the start of the next sentence
+//  nmea_parser_t* p - the parser to reset
+void nmea_init(nmea_parser_t* p){
+  p->len = 0;
+  p->state = NMEA_IDLE;
+  p->rejected = 0;
+  p->types = NULL;
+  p->num_types = 0;
+}
+
+//sets which types of sentence a parser keeps, whatever their talker
+//  (NOTE: the rest are dropped at their first comma, and so are proprietary
+//   sentences like "$PMTK001")
+//  nmea_parser_t* p - the parser
+//  const char* PROGMEM types - the 3 letter types one after another, e.g.
+//    "GGA" "RMC", or NULL to keep everything
+//  uint8_t count - how many types there are
+void nmea_set_types(nmea_parser_t* p, const char* PROGMEM types,
+                    uint8_t count){
+  p->types = types;
+  p->num_types = count;
+}
+
+//looks up the type of the sentence being collected, once its address field
+//is complete
+//  nmea_parser_t* p - the parser
+//  returns uint8_t - 1 if the sentence is one to keep, 0 otherwise
+static uint8_t nmea_lookup_type(nmea_parser_t* p){
+  const char* type = p->types;
+  uint8_t i;
+
+  if( type == NULL ){
+    p->type = NMEA_TYPE_ANY;
+    return 1;
+  }
+
+  //the address is "$", a 2 letter talker, then the type
+  if( p->len != 6 ){
+    return 0;
+  }
+  for( i = 0; i < p->num_types; i++ ){
+    if( (pgm_read_byte_near(type) == p->buf[3]) &&
+        (pgm_read_byte_near(type+1) == p->buf[4]) &&
+        (pgm_read_byte_near(type+2) == p->buf[5]) ){
+      p->type = i;
+      return 1;
+    }
+    type += 3;
+  }
+
+  return 0;
+}
+
+//drops the sentence being collected because it's bad
+static void nmea_reject(nmea_parser_t* p){
+  p->state = NMEA_IDLE;
+  if( p->rejected != 0xFF ){
+    p->rejected++;
+  }
+}
+
+//feeds a received character to a parser
+//  (NOTE: p->buf is only valid until the next call to nmea_feed, sentences
+//   are complete at the last checksum digit, and ones with a bad or missing
+//   checksum are dropped as soon as that is known)
+//  nmea_parser_t* p - the parser
+//  char c - the character that was received
+//  returns uint8_t - 1 if p->buf now holds a complete sentence with a good
+//    checksum, 0 otherwise (p->type says which type it is)
+uint8_t nmea_feed(nmea_parser_t* p, char c){
+  uint8_t result = 0;
+  uint8_t digit;
+
+  //a "$" always starts a new sentence, even in the middle of another one
+  // (that one must have lost its ending)
+  if( c == '$' ){
+    p->buf[0] = c;
+    p->len = 1;
+    p->sum = 0;
+    p->state = NMEA_ADDRESS;
+  } else if( p->state == NMEA_IDLE ){
+    //nothing to do until the next "$" (this includes the CR LF after a
+    // sentence that was already handed off)
+  } else if( (c == '\r') || (c == '\n') || (p->len >= NMEA_MAX_LEN) ){
+    //the line ended before the checksum did, or it's too long to be valid
+    nmea_reject(p);
+  } else if( (p->state == NMEA_ADDRESS) && ((c == ',') || (c == '*')) &&
+             !nmea_lookup_type(p) ){
+    //not a sentence we want, don't bother collecting the rest of it
+    p->state = NMEA_IDLE;
+  } else {
+    p->buf[p->len] = c;
+    p->len++;
+
+    if( p->state <= NMEA_BODY ){
+      //the checksum covers everything up to the "*", and the address ends
+      // at the first ","
+      if( c == '*' ){
+        p->state = NMEA_CHECKSUM1;
+      } else {
+        p->sum ^= c;
+        if( c == ',' ){
+          p->state = NMEA_BODY;
+        }
+      }
+    } else {
+      //each digit is checked as it comes in
+      digit = nmea_hex(c);
+      if( p->state == NMEA_CHECKSUM1 ){
+        if( digit == (p->sum >> 4) ){
+          p->state = NMEA_CHECKSUM2;
+        } else {
+          nmea_reject(p);
+        }
+      } else if( digit == (p->sum & 0x0F) ){
+        //the sentence is good, hand it off
+        p->buf[p->len] = '\0';
+        p->state = NMEA_IDLE;
+        result = 1;
+      } else {
+        nmea_reject(p);
+      }
+    }
+  }
+
+  return result;
+}
+
+//finds the start of every field in a sentence in a single pass
+//  (NOTE: the sentence is not modified, fields past NMEA_MAX_FIELDS are
+//   ignored)
+//  const char* line - a NULL-terminated sentence
+//  nmea_fields_t* f - where to store the field offsets
+//  returns uint8_t - the number of fields found
+uint8_t nmea_tokenize(const char* line, nmea_fields_t* f){
+  uint8_t i = 0;
+  char ch;
+
+  f->line = line;
+  f->start[0] = 0;
+  f->count = 1;
+
+  //every comma before the checksum starts another field
+  while( ((ch = line[i]) != '\0') && (ch != '*') ){
+    i++;
+    if( (ch == ',') && (f->count < NMEA_MAX_FIELDS) ){
+      f->start[f->count] = i;
+      f->count++;
+    }
+  }
+
+  return f->count;
+}
+
+//gets a field of a tokenized sentence
+//  const nmea_fields_t* f - the tokenized sentence
+//  uint8_t idx - which field to get (0 is the "$GPxxx" address field)
+//  returns const char* - the start of the field, an empty field if idx is out
+//    of range
+const char* nmea_field(const nmea_fields_t* f, uint8_t idx){
+  if( idx >= f->count ){
+    return nmea_no_field;
+  }
+
+  return f->line + f->start[idx];
+}
+
+//copies the text of a field, so it can be decoded later
+//  const char* field - the field to copy
+//  char* dest - where to copy it to, it's always NULL-terminated
+//  uint8_t size - the size of dest (longer fields are cut short)
+void nmea_copy_field(const char* field, char* dest, uint8_t size){
+  while( (size > 1) && !nmea_is_delim(*field) ){
+    *dest = *field;
+    dest++;
+    field++;
+    size--;
+  }
+  *dest = '\0';
+}
+
+//checks if a field has no characters in it (e.g. the ones in ",,")
+//  const char* field - the field to check
+//  returns uint8_t - 1 if the field is empty, 0 otherwise
+uint8_t nmea_field_empty(const char* field){
+  return nmea_is_delim(field[0]);
+}
+
+//decodes an integer field, stopping at the first character that isn't a
+//digit (so the fraction of "043005.786" is ignored)
+//  const char* field - the field to decode
+//  returns int32_t - the value, 0 if the field is empty
+int32_t nmea_parse_int(const char* field){
+  return nmea_parse_fixed(field, 0);
+}
+
+//decodes a decimal field into fixed point
+//  (NOTE: extra digits are truncated, missing ones are taken as 0)
+//  const char* field - the field to decode, e.g. "122.8"
+//  uint8_t decimals - how many digits to keep after the point
+//  returns int32_t - the value times 10^decimals, 0 if the field is empty
+int32_t nmea_parse_fixed(const char* field, uint8_t decimals){
+  int32_t result = 0;
+  uint8_t negative = 0;
+
+  if( *field == '-' ){
+    negative = 1;
+    field++;
+  }
+
+  //whole part
+  while( nmea_is_digit(*field) ){
+    result = result*10 + (*field - '0');
+    field++;
+  }
+
+  //fractional part, padded or cut to the number of decimals asked for
+  if( *field == '.' ){
+    field++;
+  }
+  while( decimals > 0 ){
+    result *= 10;
+    if( nmea_is_digit(*field) ){
+      result += (*field - '0');
+      field++;
+    }
+    decimals--;
+  }
+
+  if( negative ){
+    result = -result;
+  }
+
+  return result;
+}
+
+//decodes a (d)ddmm.mmmm latitude or longitude field
+//  (NOTE: the hemisphere is in the next field, the result is never negative)
+//  const char* field - the field to decode, e.g. "4313.4782"
+//  returns int32_t - the angle in units of 1e-7 degrees, 0 if the field is
+//    empty
+int32_t nmea_parse_dm(const char* field){
+  //minutes to 5 decimals fit in 32 bits even after the *5 below
+  int32_t dm = nmea_parse_fixed(field, 5);
+  int32_t degrees = dm / 10000000;
+  int32_t minutes = dm - degrees*10000000;
+
+  //1e-5 minutes to 1e-7 degrees is *100/60, rounded
+  return degrees*10000000 + (minutes*5 + 1)/3;
+}
@@ -0,0 +1,141 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#ifndef __NMEA_H
+#define __NMEA_H
+
+#include <inttypes.h>
+
+//longest sentence NMEA 0183 allows, counting the "$" and "*hh" but not the
+//CR LF at the end
+#define NMEA_MAX_LEN 82
+
+//most fields any sentence we parse can have (GSA has 18, counting the
+//address field)
+#define NMEA_MAX_FIELDS 20
+
+//states of the sentence framer
+#define NMEA_IDLE      0 //waiting for a "$"
+#define NMEA_ADDRESS   1 //collecting the talker and sentence type
+#define NMEA_BODY      2 //collecting the rest of the sentence
+#define NMEA_CHECKSUM1 3 //waiting for the first digit of the checksum
+#define NMEA_CHECKSUM2 4 //waiting for the second digit of the checksum
+
+//the type of a sentence that wasn't looked up (see nmea_set_types)
+#define NMEA_TYPE_ANY 0xFF
+
+//assembles NMEA sentences one byte at a time, checking the checksum as it
+//goes
+struct nmea_parser {
+  char buf[NMEA_MAX_LEN+1]; //the sentence, NULL-terminated once complete
+  uint8_t len;              //number of characters collected so far
+  uint8_t state;            //one of the NMEA_* framer states
+  uint8_t sum;              //XOR of everything between the "$" and "*"
+  uint8_t rejected;         //number of bad sentences (saturates at 255)
+  const char* types;        //sentence types to keep, in program space
+  uint8_t num_types;        //number of them
+  uint8_t type;             //which of them the sentence is
+};
+typedef struct nmea_parser nmea_parser_t;
+
+//where each field of a sentence starts
+//  the fields are left in place in the sentence, each one ends at the next
+//  ",", "*" or NULL
+struct nmea_fields {
+  const char* line;                //the sentence that was tokenized
+  uint8_t count;                   //number of fields found
+  uint8_t start[NMEA_MAX_FIELDS];  //offset of each field into line
+};
+typedef struct nmea_fields nmea_fields_t;
+
+//resets a parser so it waits for the start of the next sentence
+//  (NOTE: this also makes it keep every type of sentence again)
+//  nmea_parser_t* p - the parser to reset
+void nmea_init(nmea_parser_t* p);
+
+//sets which types of sentence a parser keeps, whatever their talker
+//  (NOTE: the rest are dropped at their first comma, and so are proprietary
+//   sentences like "$PMTK001")
+//  nmea_parser_t* p - the parser
+//  const char* PROGMEM types - the 3 letter types one after another, e.g.
+//    "GGA" "RMC", or NULL to keep everything
+//  uint8_t count - how many types there are
+void nmea_set_types(nmea_parser_t* p, const char* PROGMEM types,
+                    uint8_t count);
+
+//feeds a received character to a parser
+//  (NOTE: p->buf is only valid until the next call to nmea_feed, sentences
+//   are complete at the last checksum digit, and ones with a bad or missing
+//   checksum are dropped as soon as that is known)
+//  nmea_parser_t* p - the parser
+//  char c - the character that was received
+//  returns uint8_t - 1 if p->buf now holds a complete sentence with a good
+//    checksum, 0 otherwise (p->type says which type it is)
+uint8_t nmea_feed(nmea_parser_t* p, char c);
+
+//finds the start of every field in a sentence in a single pass
+//  (NOTE: the sentence is not modified, fields past NMEA_MAX_FIELDS are
+//   ignored)
+//  const char* line - a NULL-terminated sentence
+//  nmea_fields_t* f - where to store the field offsets
+//  returns uint8_t - the number of fields found
+uint8_t nmea_tokenize(const char* line, nmea_fields_t* f);
+
+//gets a field of a tokenized sentence
+//  const nmea_fields_t* f - the tokenized sentence
+//  uint8_t idx - which field to get (0 is the "$GPxxx" address field)
+//  returns const char* - the start of the field, an empty field if idx is out
+//    of range
+const char* nmea_field(const nmea_fields_t* f, uint8_t idx);
+
+//copies the text of a field, so it can be decoded later
+//  const char* field - the field to copy
+//  char* dest - where to copy it to, it's always NULL-terminated
+//  uint8_t size - the size of dest (longer fields are cut short)
+void nmea_copy_field(const char* field, char* dest, uint8_t size);
+
+//checks if a field has no characters in it (e.g. the ones in ",,")
+//  const char* field - the field to check
+//  returns uint8_t - 1 if the field is empty, 0 otherwise
+uint8_t nmea_field_empty(const char* field);
+
+//decodes an integer field, stopping at the first character that isn't a
+//digit (so the fraction of "043005.786" is ignored)
+//  const char* field - the field to decode
+//  returns int32_t - the value, 0 if the field is empty
+int32_t nmea_parse_int(const char* field);
+
+//decodes a decimal field into fixed point
+//  (NOTE: extra digits are truncated, missing ones are taken as 0)
+//  const char* field - the field to decode, e.g. "122.8"
+//  uint8_t decimals - how many digits to keep after the point
+//  returns int32_t - the value times 10^decimals, 0 if the field is empty
+int32_t nmea_parse_fixed(const char* field, uint8_t decimals);
+
+//decodes a (d)ddmm.mmmm latitude or longitude field
+//  (NOTE: the hemisphere is in the next field, the result is never negative)
+//  const char* field - the field to decode, e.g. "4313.4782"
+//  returns int32_t - the angle in units of 1e-7 degrees, 0 if the field is
+//    empty
+int32_t nmea_parse_dm(const char* field);
+
+#endif
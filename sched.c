@@ -0,0 +1,153 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#include <inttypes.h>
+#include <string.h> //for memset and NULL
+#include "sched.h"
+#include "tick.h"
+
+//a task and when it runs next
+struct sched_task {
+  sched_fn fn;
+  uint16_t period;    //in milliseconds
+  uint32_t budget;    //in CPU cycles
+  tick_timer_t next;  //when it's due
+  sched_stats_t stats;
+};
+
+static struct sched_task sched_tasks[SCHED_MAX_TASKS];
+static uint8_t sched_num_tasks = 0;
+//time spent going around with nothing due, in CPU cycles
+static uint32_t sched_idle = 0;
+
+//adds a task, tasks added first run first when several are due
+//  sched_fn fn - the task
+//  uint16_t period - how often to run it in milliseconds, 0 for as often as
+//    possible
+//  uint16_t budget - how long a run should take at most in microseconds
+//    (going over is only counted, see sched_stats_t)
+//  returns uint8_t - the task's number, for sched_wake and sched_get_stats,
+//    or SCHED_NO_TASK if SCHED_MAX_TASKS have been added already
+uint8_t sched_add(sched_fn fn, uint16_t period, uint16_t budget){
+  struct sched_task* t;
+
+  if( sched_num_tasks >= SCHED_MAX_TASKS ){
+    return SCHED_NO_TASK;
+  }
+  t = &sched_tasks[sched_num_tasks];
+
+  t->fn = fn;
+  t->period = period;
+  //(TICK_CYCLES is per millisecond)
+  t->budget = ((uint32_t)budget*TICK_CYCLES)/1000;
+  tick_timer_start(&(t->next), 0);
+  memset(&(t->stats), 0, sizeof(t->stats));
+
+  return sched_num_tasks++;
+}
+
+//makes a task due now, instead of at the end of its period
+//  uint8_t task - the task's number (nothing happens if there's no such task)
+void sched_wake(uint8_t task){
+  if( task >= sched_num_tasks ){
+    return;
+  }
+
+  tick_timer_start(&(sched_tasks[task].next), 0);
+}
+
+//runs a task and keeps track of the time it took
+//  struct sched_task* t - the task
+static void sched_run_task(struct sched_task* t){
+  uint32_t start, used;
+
+  //the next run is a period after this one was due, so the period doesn't
+  // drift, unless this one is so late the next is due already
+  t->next += t->period;
+  if( tick_timer_expired(&(t->next)) ){
+    tick_timer_start(&(t->next), t->period);
+  }
+
+  start = tick_cycles();
+  (t->fn)();
+  used = tick_cycles() - start;
+
+  (t->stats.runs)++;
+  t->stats.cycles += used;
+  if( used > t->stats.worst ){
+    t->stats.worst = used;
+  }
+  if( (used > t->budget) && (t->stats.overruns != 0xFFFF) ){
+    (t->stats.overruns)++;
+  }
+}
+
+//runs the tasks forever
+//  (NOTE: the tick has to be running, see tick_init)
+void sched_run(){
+  uint32_t start;
+  uint8_t i, ran;
+
+  for(;;){
+    start = tick_cycles();
+    ran = 0;
+
+    for(i=0; i<sched_num_tasks; i++){
+      if( tick_timer_expired(&(sched_tasks[i].next)) ){
+        sched_run_task(&sched_tasks[i]);
+        ran = 1;
+      }
+    }
+
+    //a time around with nothing to do was idle
+    if( !ran ){
+      sched_idle += tick_cycles() - start;
+    }
+  }
+}
+
+//gets where a task's time has gone
+//  uint8_t task - the task's number
+//  returns const sched_stats_t* - its stats, NULL if there's no such task
+const sched_stats_t* sched_get_stats(uint8_t task){
+  if( task >= sched_num_tasks ){
+    return NULL;
+  }
+
+  return &(sched_tasks[task].stats);
+}
+
+//gets how long the scheduler has spent with nothing due
+//  returns uint32_t - the time in CPU cycles (wraps around)
+uint32_t sched_idle_cycles(){
+  return sched_idle;
+}
+
+//starts every task's stats (and the idle time) over
+void sched_reset_stats(){
+  uint8_t i;
+
+  for(i=0; i<sched_num_tasks; i++){
+    memset(&(sched_tasks[i].stats), 0, sizeof(sched_tasks[i].stats));
+  }
+  sched_idle = 0;
+}
@@ -0,0 +1,80 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#ifndef __SCHED_H
+#define __SCHED_H
+
+#include <inttypes.h>
+
+//most tasks that can be added (change it to suit)
+#ifndef SCHED_MAX_TASKS
+#define SCHED_MAX_TASKS 5
+#endif
+
+//what sched_add returns when there's no room for another task
+#define SCHED_NO_TASK 0xFF
+
+//a task, which has to return as soon as it's done what it can (nothing else
+//runs until it does)
+typedef void (*sched_fn)(void);
+
+//where a task's time goes
+//  (NOTE: times are in CPU cycles, see tick_cycles)
+struct sched_stats {
+  uint32_t runs;     //how many times it has run
+  uint32_t cycles;   //how long it has run for in total (wraps around)
+  uint32_t worst;    //the longest it has taken to run once
+  uint16_t overruns; //how many runs took longer than its budget (saturates)
+};
+typedef struct sched_stats sched_stats_t;
+
+//adds a task, tasks added first run first when several are due
+//  sched_fn fn - the task
+//  uint16_t period - how often to run it in milliseconds, 0 for as often as
+//    possible
+//  uint16_t budget - how long a run should take at most in microseconds
+//    (going over is only counted, see sched_stats_t)
+//  returns uint8_t - the task's number, for sched_wake and sched_get_stats,
+//    or SCHED_NO_TASK if SCHED_MAX_TASKS have been added already
+uint8_t sched_add(sched_fn fn, uint16_t period, uint16_t budget);
+
+//makes a task due now, instead of at the end of its period
+//  uint8_t task - the task's number (nothing happens if there's no such task)
+void sched_wake(uint8_t task);
+
+//runs the tasks forever
+//  (NOTE: the tick has to be running, see tick_init)
+void sched_run();
+
+//gets where a task's time has gone
+//  uint8_t task - the task's number
+//  returns const sched_stats_t* - its stats, NULL if there's no such task
+const sched_stats_t* sched_get_stats(uint8_t task);
+
+//gets how long the scheduler has spent with nothing due
+//  returns uint32_t - the time in CPU cycles (wraps around)
+uint32_t sched_idle_cycles();
+
+//starts every task's stats (and the idle time) over
+void sched_reset_stats();
+
+#endif
@@ -23,87 +23,236 @@ SOFTWARE.
 #include <avr/eeprom.h> //for EEPROM read/write
 #include <inttypes.h> //for uint16_t
 #include "storage.h"
-#include "gps.h" //for loc_state_t
+#include "gps.h" //for loc_state_t, gps_set_dest and gps_get_position
+#include "coord_dist.h" //for COORD_PER_DEG
 
 //For EEPROM documentation, see:
 //  http://www.nongnu.org/avr-libc/user-manual/group__avr__eeprom.html
 
-//stores a floating point number into the EEPROM
-//  uint16_t idx - the one-float-sized bank to store the float into
-//  float data - the data to store
-void store_float(uint16_t idx, float data){
-  //wait for the EEPROM to not be busy
+//how many bytes can be waiting to be written (two slots' worth)
+#define STORAGE_QUEUE_LEN (SLOT_SIZE*2)
+//how many times to write a byte before giving up on it
+static const uint8_t __STORAGE_TRIES = 3;
+
+//a byte waiting to be written
+struct storage_write {
+  uint16_t addr;
+  uint8_t data;
+  uint8_t tries; //how many times it's been written
+};
+
+//the bytes waiting to be written, oldest first
+static struct storage_write storage_queue[STORAGE_QUEUE_LEN];
+static uint8_t storage_head = 0;
+static uint8_t storage_count = 0;
+//how many bytes couldn't be written (saturates at 255)
+static uint8_t storage_failed = 0;
+
+//converts a coordinate saved as a float in degrees by older firmware
+//  uint32_t* raw - the float, as it was read, replaced by the coordinate in
+//    fixed point
+//  int32_t limit - the most it can be, in degrees
+//  returns uint8_t - 1 if it was a coordinate, 0 otherwise
+static uint8_t storage_convert_float(uint32_t* raw, int32_t limit){
+  union {
+    uint32_t raw;
+    float deg;
+  } old;
+
+  old.raw = *raw;
+  //a blank slot reads as NaN, which fails both of these
+  if( !((old.deg >= -limit) && (old.deg <= limit)) ){
+    return 0;
+  }
+
+  *raw = (uint32_t)(int32_t)( old.deg*COORD_PER_DEG +
+                              ((old.deg < 0) ? -0.5 : 0.5) );
+  return 1;
+}
+
+//checks what format the EEPROM is in, and converts the slots to fixed point
+//if they were saved as floats by older firmware
+//  (NOTE: has to be called before anything else here, this waits for every
+//   byte it writes, but only slots that were used need it, and only once)
+void storage_init(){
+  uint32_t* format = (uint32_t*)(CONFIG_SLOT*SLOT_SIZE+4);
+  uint32_t* addr;
+  uint32_t next, lat, lon;
+  uint16_t slot = 0;
+
   eeprom_busy_wait();
-  //the first parameter of eeprom_write_float is the address to write to in
-  //  bytes, I only use the (float*) cast to make the compiler shut up
-  eeprom_write_float((float*)(idx*sizeof(float)), data);
+  next = eeprom_read_dword(format);
+  if( next == STORAGE_FORMAT ){
+    return;
+  }
+  //while converting, the format is the next slot to convert, so losing power
+  // partway through carries on from there (only the slot being converted
+  // right then can be lost, older firmware left the float of a longitude
+  // here, which only reads that small if it's 0)
+  if( next < CONFIG_SLOT ){
+    slot = next;
+  }
+
+  //(the config slot was a location too, but nothing in it is worth keeping)
+  for(; slot<CONFIG_SLOT; slot++){
+    addr = (uint32_t*)(slot*SLOT_SIZE);
+    lat = eeprom_read_dword(addr);
+    lon = eeprom_read_dword(addr+1);
+    //anything that isn't a location is blanked, like it was never saved
+    // (eeprom_update_dword skips the bytes that don't change, so slots that
+    // are already blank cost nothing)
+    if( !storage_convert_float(&lat, 90) ||
+        !storage_convert_float(&lon, 180) ){
+      lat = 0xFFFFFFFFUL;
+      lon = 0xFFFFFFFFUL;
+    }
+    eeprom_update_dword(addr, lat);
+    eeprom_update_dword(addr+1, lon);
+    eeprom_update_dword(format, slot+1);
+  }
+
+  eeprom_update_dword(format, STORAGE_FORMAT);
+}
+
+//writes the next waiting byte to the EEPROM, if it isn't busy
+//  (NOTE: this is a task, see sched.h, each byte takes about 3.3ms to write
+//   but this never waits for it)
+void storage_task(){
+  struct storage_write* w = &storage_queue[storage_head];
+
+  if( (storage_count == 0) || !eeprom_is_ready() ){
+    return;
+  }
+
+  //reading it back first skips bytes that are already right, and checks the
+  // ones that have been written
+  if( eeprom_read_byte((const uint8_t*)(w->addr)) != w->data ){
+    if( w->tries < __STORAGE_TRIES ){
+      (w->tries)++;
+      eeprom_write_byte((uint8_t*)(w->addr), w->data);
+      return;
+    }
+
+    //it didn't take
+    if( storage_failed != 0xFF ){
+      storage_failed++;
+    }
+  }
+
+  //done with it
+  storage_head = (storage_head+1) % STORAGE_QUEUE_LEN;
+  storage_count--;
+}
+
+//writes every waiting byte to the EEPROM, waiting for each one
+void storage_flush(){
+  while( storage_count ){
+    storage_task();
+  }
+}
+
+//queues a double word to be written to the EEPROM
+//  (NOTE: if there isn't room, this waits for what's there to be written)
+//  uint16_t addr - the address to write to, in bytes
+//  uint32_t data - the data to write
+static void storage_queue_dword(uint16_t addr, uint32_t data){
+  struct storage_write* w;
+  uint8_t i;
+
+  if( storage_count > STORAGE_QUEUE_LEN-sizeof(data) ){
+    storage_flush();
+  }
+
+  //(least significant byte first, the same as eeprom_write_dword)
+  for(i=0; i<sizeof(data); i++){
+    w = &storage_queue[(storage_head+storage_count) % STORAGE_QUEUE_LEN];
+    w->addr = addr+i;
+    w->data = (uint8_t)data;
+    w->tries = 0;
+    data >>= 8;
+    storage_count++;
+  }
+}
+
+//stores a fixed point coordinate into the EEPROM
+//  uint16_t idx - the one-coordinate-sized bank to store the coordinate into
+//  int32_t data - the data to store
+void store_coord(uint16_t idx, int32_t data){
+  //it's written in the background (see storage_task)
+  storage_queue_dword(idx*sizeof(int32_t), (uint32_t)data);
 }
 
-//stores a floating point number into the EEPROM
-//  uint16_t idx - the one-float-sized bank to read the float from
-//  return float - the data read
-float get_float(uint16_t idx){
+//reads a fixed point coordinate from the EEPROM
+//  uint16_t idx - the one-coordinate-sized bank to read the coordinate from
+//  return int32_t - the data read
+int32_t get_coord(uint16_t idx){
+  //anything still waiting to be written might be what's being read
+  storage_flush();
   //wait for the EEPROM to not be busy
   eeprom_busy_wait();
-  //the first parameter of eeprom_read_float is the address to write to in
-  //  bytes, I only use the (float*) cast to make the compiler shut up
-  return eeprom_read_float((float*)(idx*sizeof(float)));
+  //the first parameter of eeprom_read_dword is the address to write to in
+  //  bytes, I only use the (uint32_t*) cast to make the compiler shut up
+  return (int32_t)eeprom_read_dword((uint32_t*)(idx*sizeof(int32_t)));
 }
 
 //stores the current location to the EEPROM
+//  (NOTE: this is the last update's position, see gps_get_position)
 //  uint16_t slot - the slot to store data to
-//  const loc_state_t* loc - the location to read data from
-//  returns char - 0 if the save failed, 1 otherwise
-char store_loc(uint16_t slot, const loc_state_t* loc){
-  char result = 0;
+//  returns char - 0 if the EEPROM has ever failed to take a write (it's
+//    probably worn out), 1 otherwise
+char store_loc(uint16_t slot){
+  int32_t lat, lon;
 
-  slot *= 2; //since this is a *pair* of floats
+  slot *= 2; //since this is a *pair* of coordinates
 
-  //store the first float
-  store_float(slot, (loc->curr_lat));
-  //store the second float
-  store_float(slot+1, (loc->curr_long));
+  //not the position on the display, which is extrapolated between updates
+  gps_get_position( &lat, &lon );
 
-  //verify the write
-  if( ((loc->curr_lat) == get_float(slot)) &&
-      ((loc->curr_long) == get_float(slot+1)) ){
-    result = 1;
-  }
+  //store both coordinates (they're written in the background, and checked
+  // as they are, see storage_task)
+  store_coord(slot, lat);
+  store_coord(slot+1, lon);
 
-  return result;
+  return (storage_failed == 0);
 }
 
 //stores the trip destination to the EEPROM
 //  uint16_t slot - the slot to store data to
 //  const loc_state_t* loc - the location to read data from
-//  returns char - 0 if the save failed, 1 otherwise
+//  returns char - 0 if the EEPROM has ever failed to take a write (it's
+//    probably worn out), 1 otherwise
 char store_dest(uint16_t slot, const loc_state_t* loc){
-  char result = 0;
+  slot *= 2; //since this is a *pair* of coordinates
 
-  slot *= 2; //since this is a *pair* of floats
-
-  //store the first float
-  store_float(slot, (loc->dest_lat));
-  //store the second float
-  store_float(slot+1, (loc->dest_long));
-
-  //verify the write
-  if( ((loc->dest_lat) == get_float(slot)) &&
-      ((loc->dest_long) == get_float(slot+1)) ){
-    result = 1;
-  }
+  //store both coordinates (they're written in the background, and checked
+  // as they are, see storage_task)
+  store_coord(slot, (loc->dest_lat));
+  store_coord(slot+1, (loc->dest_long));
 
-  return result;
+  return (storage_failed == 0);
 }
 
 //reads the trip destination from the EEPROM
 //  uint16_t slot - the slot to read data from
 //  loc_state_t* loc - the location to write data to
 void read_dest(uint16_t slot, loc_state_t* loc){
-  slot *= 2; //since this is a *pair* of floats
+  slot *= 2; //since this is a *pair* of coordinates
 
-  //get the first float
-  (loc->dest_lat) = get_float(slot);
-  //store the second float
-  (loc->dest_long) = get_float(slot+1);
+  //get both coordinates
+  gps_set_dest( loc, get_coord(slot), get_coord(slot+1) );
+}
+
+//stores the baud rate the GPS was last set to into the EEPROM
+//  uint32_t baud - the baud rate
+void store_gps_baud(uint32_t baud){
+  //it's the first thing in the config slot
+  storage_queue_dword(CONFIG_SLOT*SLOT_SIZE, baud);
+}
+
+//reads the baud rate the GPS was last set to from the EEPROM
+//  returns uint32_t - the baud rate (garbage if it was never stored)
+uint32_t get_gps_baud(){
+  storage_flush();
+  eeprom_busy_wait();
+  return eeprom_read_dword((uint32_t*)(CONFIG_SLOT*SLOT_SIZE));
 }
@@ -26,25 +26,54 @@ SOFTWARE.
 #include <inttypes.h> //for uin16_t
 #include "gps.h" //for loc_state_t
 
-//stores a floating point number into the EEPROM
-//  uint16_t idx - the one-float-sized bank to store the float into
-//  float data - the data to store
-void store_float(uint16_t idx, float data);
+//EEPROM constraints (change EEPROM_SIZE depending on your MCU)
+#define SLOT_SIZE (sizeof(int32_t)*2)
+#define EEPROM_SIZE 2048
+#define NUM_SLOTS (EEPROM_SIZE/SLOT_SIZE)
+//the last slot holds settings instead of a location, so locations can only
+//go in the slots below it
+#define CONFIG_SLOT (NUM_SLOTS-1)
+//marks the EEPROM as holding fixed point coordinates, it goes in the second
+//half of the config slot (firmware before it stored floats, see storage_init)
+#define STORAGE_FORMAT 0x31435754UL
 
-//stores a floating point number into the EEPROM
-//  uint16_t idx - the one-float-sized bank to read the float from
-//  return float - the data read
-float get_float(uint16_t idx);
+//checks what format the EEPROM is in, and converts the slots to fixed point
+//if they were saved as floats by older firmware
+//  (NOTE: has to be called before anything else here, this waits for every
+//   byte it writes, but only slots that were used need it, and only once)
+void storage_init();
+
+//writes the next waiting byte to the EEPROM, if it isn't busy
+//  (NOTE: this is a task, see sched.h, each byte takes about 3.3ms to write
+//   but this never waits for it)
+void storage_task();
+
+//writes every waiting byte to the EEPROM, waiting for each one
+void storage_flush();
+
+//stores a fixed point coordinate into the EEPROM
+//  (NOTE: it's written in the background by storage_task)
+//  uint16_t idx - the one-coordinate-sized bank to store the coordinate into
+//  int32_t data - the data to store
+void store_coord(uint16_t idx, int32_t data);
+
+//reads a fixed point coordinate from the EEPROM
+//  uint16_t idx - the one-coordinate-sized bank to read the coordinate from
+//  return int32_t - the data read
+int32_t get_coord(uint16_t idx);
 
 //stores the current location to the EEPROM
+//  (NOTE: this is the last update's position, see gps_get_position)
 //  uint16_t slot - the slot to store data to
-//  const loc_state_t* loc - the location to read data from
-//  returns char - 0 if the save failed, 1 otherwise
-char store_loc(uint16_t slot, const loc_state_t* loc);
+//  returns char - 0 if the EEPROM has ever failed to take a write (it's
+//    probably worn out), 1 otherwise
+char store_loc(uint16_t slot);
 
 //stores the trip destination to the EEPROM
 //  uint16_t slot - the slot to store data to
 //  const loc_state_t* loc - the location to read data from
+//  returns char - 0 if the EEPROM has ever failed to take a write (it's
+//    probably worn out), 1 otherwise
 char store_dest(uint16_t slot, const loc_state_t* loc);
 
 //reads the trip destination from the EEPROM
@@ -52,4 +81,12 @@ char store_dest(uint16_t slot, const loc_state_t* loc);
 //  loc_state_t* loc - the location to write data to
 void read_dest(uint16_t slot, loc_state_t* loc);
 
+//stores the baud rate the GPS was last set to into the EEPROM
+//  uint32_t baud - the baud rate
+void store_gps_baud(uint32_t baud);
+
+//reads the baud rate the GPS was last set to from the EEPROM
+//  returns uint32_t - the baud rate (garbage if it was never stored)
+uint32_t get_gps_baud();
+
 #endif
@@ -0,0 +1,107 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "tick.h"
+
+//milliseconds since tick_init
+//  (NOTE: 4 bytes, so the main program has to read it with interrupts off)
+static volatile uint32_t tick_count = 0;
+//thousandths of a cycle the ticks so far have been short by
+static uint16_t tick_frac = 0;
+
+//counts a millisecond
+ISR(TIMER1_COMPA_vect){
+  tick_count++;
+
+  //the timer has just cleared, so this sets how long the next tick is
+  tick_frac += TICK_FRAC;
+  if( tick_frac >= 1000 ){
+    tick_frac -= 1000;
+    OCR1A = TICK_CYCLES;
+  } else {
+    OCR1A = TICK_CYCLES-1;
+  }
+}
+
+//starts the millisecond tick (Timer1)
+//  (NOTE: interrupts need to be on for it to count)
+void tick_init(){
+  //count CPU cycles (no prescaler), clearing at OCR1A (CTC mode)
+  TCCR1A = 0;
+  TCCR1B = (1<<WGM12)|(1<<CS10);
+  OCR1A = TICK_CYCLES-1;
+
+  //interrupt every time it clears
+  TIMSK1 |= (1<<OCIE1A);
+}
+
+//gets how long it's been since tick_init
+//  (NOTE: wraps around after about 49 days, so only compare differences)
+//  returns uint32_t - the time in milliseconds
+uint32_t tick_ms(){
+  uint32_t result;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+    result = tick_count;
+  }
+
+  return result;
+}
+
+//gets a finer time than tick_ms, for measuring how long things take
+//  (NOTE: wraps around after about 10 minutes, so only compare differences,
+//   and every tick counts as TICK_CYCLES, so it runs about 108ppm slow)
+//  returns uint32_t - the time in CPU cycles
+uint32_t tick_cycles(){
+  uint32_t count;
+  uint16_t cycles;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+    count = tick_count;
+    cycles = TCNT1;
+    //if the timer cleared after interrupts went off, its tick isn't counted
+    // yet
+    if( (TIFR1 & (1<<OCF1A)) && (cycles < TICK_CYCLES/2) ){
+      count++;
+    }
+  }
+
+  return count*TICK_CYCLES + cycles;
+}
+
+//starts (or restarts) a software timer
+//  tick_timer_t* t - the timer
+//  uint16_t ms - how long until it goes off, in milliseconds
+void tick_timer_start(tick_timer_t* t, uint16_t ms){
+  *t = tick_ms() + ms;
+}
+
+//checks if a software timer has gone off
+//  const tick_timer_t* t - the timer
+//  returns uint8_t - 1 if it has, 0 otherwise
+uint8_t tick_timer_expired(const tick_timer_t* t){
+  //(the difference is signed so it works across the wrap around)
+  return ( (int32_t)(tick_ms() - *t) >= 0 );
+}
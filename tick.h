@@ -0,0 +1,61 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#ifndef __TICK_H
+#define __TICK_H
+
+#include <inttypes.h>
+
+//CPU cycles per tick, and the thousandths of a cycle left over (at 7.3728MHz
+// that's 7372.8, so 4 ticks in 5 get one more cycle to keep tick_ms exact)
+#define TICK_CYCLES (F_CPU/1000)
+#define TICK_FRAC (F_CPU%1000)
+
+//starts the millisecond tick (Timer1)
+//  (NOTE: interrupts need to be on for it to count)
+void tick_init();
+
+//gets how long it's been since tick_init
+//  (NOTE: wraps around after about 49 days, so only compare differences)
+//  returns uint32_t - the time in milliseconds
+uint32_t tick_ms();
+
+//gets a finer time than tick_ms, for measuring how long things take
+//  (NOTE: wraps around after about 10 minutes, so only compare differences,
+//   and every tick counts as TICK_CYCLES, so it runs about 108ppm slow)
+//  returns uint32_t - the time in CPU cycles
+uint32_t tick_cycles();
+
+//a software timer, the tick_ms time it goes off at
+typedef uint32_t tick_timer_t;
+
+//starts (or restarts) a software timer
+//  tick_timer_t* t - the timer
+//  uint16_t ms - how long until it goes off, in milliseconds
+void tick_timer_start(tick_timer_t* t, uint16_t ms);
+
+//checks if a software timer has gone off
+//  const tick_timer_t* t - the timer
+//  returns uint8_t - 1 if it has, 0 otherwise
+uint8_t tick_timer_expired(const tick_timer_t* t);
+
+#endif
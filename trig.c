@@ -0,0 +1,336 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#include <inttypes.h>
+#include <avr/pgmspace.h> //for the lookup tables
+#include "trig.h"
+#include "trig_tables.h" //generated by trigtables/trigtables.c
+
+//mask for the part of a Q30 table input that falls between two entries
+#define TRIG_FRAC_BITS (30-TRIG_TABLE_BITS)
+#define TRIG_FRAC_MASK ((1UL<<TRIG_FRAC_BITS)-1)
+
+//1e-7 degrees to binary angle is *2^32/3.6e9 = *1.193046471, done as
+//  coord + coord*0.193046471, with the fraction scaled by 2^32
+static const uint32_t COORD_TO_ANGLE_FRAC = 829128280;
+
+//multiplies a 32 bit number by a 16 bit one, keeping the top 32 bits
+//  (NOTE: this is two 16x16 multiplies, which the AVR does in hardware,
+//   instead of the 64 bit multiply the compiler would call for (a*b)>>16)
+//  uint32_t a - the 32 bit number
+//  uint16_t b - the 16 bit number
+//  returns uint32_t - (a*b)>>16, rounded down
+static uint32_t trig_umul16(uint32_t a, uint16_t b){
+  return (uint32_t)(uint16_t)(a >> 16) * b +
+         (((uint32_t)(uint16_t)a * b) >> 16);
+}
+
+//linearly interpolates a lookup table
+//  const uint32_t* PROGMEM table - the table
+//  uint32_t x - where to look, a Q30 number from 0 to 1
+//  returns uint32_t - the interpolated value
+static uint32_t trig_lerp(const uint32_t* PROGMEM table, uint32_t x){
+  uint16_t idx = x >> TRIG_FRAC_BITS;
+  uint32_t frac = x & TRIG_FRAC_MASK;
+  uint32_t lo, hi;
+
+  lo = pgm_read_dword_near(&table[idx]);
+  //the last entry has nothing after it, but frac is always 0 there
+  if( frac == 0 ){
+    return lo;
+  }
+  hi = pgm_read_dword_near(&table[idx+1]);
+
+  //(hi-lo)*frac is too big for 32 bits, but hi-lo is under 2^23, so taking
+  // the top bits of the fraction on their own leaves room to shift the
+  // bottom 16 down first (all of them count for small angles)
+  hi -= lo;
+  return lo + ( (hi*(frac >> 16) + trig_umul16(hi, (uint16_t)frac)) >>
+                (TRIG_FRAC_BITS-16) );
+}
+
+//converts a fixed point coordinate into a binary angle
+//  int32_t coord - the angle in units of 1e-7 degrees
+//  returns angle_t - the same angle as a binary angle
+angle_t trig_coord_to_angle(int32_t coord){
+  uint32_t mag = (coord < 0) ? -(uint32_t)coord : (uint32_t)coord;
+  //(mag*FRAC>>32 is what trig_arc works out)
+  uint32_t frac = trig_arc(mag, COORD_TO_ANGLE_FRAC);
+
+  //(done unsigned, since 180 degrees is one past the biggest signed angle,
+  // and it wraps around to -180 like it should)
+  if( coord < 0 ){
+    return (angle_t)coord - frac;
+  }
+  return (angle_t)coord + frac;
+}
+
+//converts a binary angle to whole degrees, rounding to the nearest one
+//  angle_t a - the angle
+//  returns int16_t - the angle in degrees, from -180 to 180
+int16_t trig_angle_to_deg(angle_t a){
+  //an angle times 360 is degrees in the top 16 bits, shifting it by 180
+  // degrees first makes it unsigned (rounding up from just under 180 gives
+  // 180, not -180)
+  return (int16_t)( (trig_umul16(a + ANGLE_180, 360) + 0x8000) >> 16 ) - 180;
+}
+
+//multiplies a number by a Q30 number
+//  int32_t a - the number to multiply (Q30, or any other units)
+//  int32_t b - the Q30 number, from -1 to 1
+//  returns int32_t - a*b in the units of a
+int32_t trig_mul(int32_t a, int32_t b){
+  uint32_t ua = (a < 0) ? -(uint32_t)a : (uint32_t)a;
+  uint32_t ub = (b < 0) ? -(uint32_t)b : (uint32_t)b;
+  uint16_t ah = ua >> 16, al = ua;
+  uint16_t bh = ub >> 16, bl = ub;
+  uint32_t result;
+
+  //a*b>>30 from the 16x16 products of the halves, the way it's done by hand
+  // (b is at most 2^30, so the middle ones add up to less than 2^32), and
+  // rounded to the nearest
+  result = ( (uint32_t)al*bh + (uint32_t)ah*bl +
+             (((uint32_t)al*bl) >> 16) + (1UL << 13) ) >> 14;
+  result += ((uint32_t)ah*bh) << 2;
+
+  if( (a < 0) != (b < 0) ){
+    return -(int32_t)result;
+  }
+  return (int32_t)result;
+}
+
+//finds the length of an arc
+//  angle_t a - the angle of the arc, from 0 to just under 360 degrees
+//  uint32_t circle - the length of the whole circle, in any units
+//  returns uint32_t - the length of the arc in the same units, rounded down
+uint32_t trig_arc(angle_t a, uint32_t circle){
+  //(a*circle)>>32, as two 32x16 multiplies
+  return trig_umul16(circle, a >> 16) +
+         (trig_umul16(circle, (uint16_t)a) >> 16);
+}
+
+//calculates the sine of an angle
+//  angle_t a - the angle
+//  returns int32_t - sin(a) in Q30
+int32_t trig_sin(angle_t a){
+  uint8_t quadrant = a >> 30;
+  uint32_t x = a & (ANGLE_90-1);
+  int32_t result;
+
+  //the table only covers the first quadrant, mirror the others onto it
+  if( quadrant & 1 ){
+    x = ANGLE_90 - x;
+  }
+  result = trig_lerp(trig_sin_table, x);
+  if( quadrant & 2 ){
+    result = -result;
+  }
+
+  return result;
+}
+
+//calculates the cosine of an angle
+//  angle_t a - the angle
+//  returns int32_t - cos(a) in Q30
+int32_t trig_cos(angle_t a){
+  return trig_sin(a + ANGLE_90);
+}
+
+//divides two numbers, keeping about 16 significant bits of the result
+//  uint32_t num - the numerator
+//  uint32_t den - the denominator, more than num/4
+//  returns uint32_t - num/den in Q30, rounded to the nearest 16 bits (and
+//    0xFFFFFFFF if that rounds up past 4)
+static uint32_t trig_div16(uint32_t num, uint32_t den){
+  int8_t shift = 30;
+  uint32_t rem;
+
+  if( num == 0 ){
+    return 0;
+  }
+
+  //scale like a float: the numerator up to 32 bits and the denominator down
+  // to 16 (rounding once at the end, since rounding every step adds up), so
+  // a 32 bit divide keeps its precision for tiny ratios
+  while( num < 0x80000000UL ){
+    num <<= 1;
+    shift--;
+  }
+  while( den > 0x1FFFFUL ){
+    den >>= 1;
+    shift--;
+  }
+  if( den > 0xFFFFUL ){
+    den = (den >> 1) + (den & 1);
+    shift--;
+  }
+  //(the remainder comes from the same divide)
+  rem = num % den;
+  num /= den;
+  if( rem >= den - rem ){
+    num++;
+  }
+
+  if( shift >= 0 ){
+    if( (shift > 0) && (num >> (32-shift)) ){
+      return 0xFFFFFFFFUL;
+    }
+    num <<= shift;
+  } else if( shift > -32 ){
+    num >>= -shift;
+  } else {
+    num = 0;
+  }
+
+  return num;
+}
+
+//multiplies two unsigned numbers, one of them Q30
+//  (NOTE: the result wraps around if it doesn't fit, which is fine for
+//   finding how far off a division or square root is)
+//  uint32_t a - the number to multiply
+//  uint32_t b - the Q30 number
+//  returns uint32_t - a*b>>30, rounded down (only bits below the result are
+//    dropped, so it's off by about 1 at most)
+static uint32_t trig_umul30(uint32_t a, uint32_t b){
+  uint16_t ah = a >> 16, al = a;
+  uint16_t bh = b >> 16, bl = b;
+  //the middle products and the top of the bottom one, in units of 2^18
+  uint32_t mid = ( ((uint32_t)ah*bl) >> 2 ) + ( ((uint32_t)al*bh) >> 2 ) +
+                 ( ((uint32_t)al*bl) >> 18 );
+
+  return ( ((uint32_t)ah*bh) << 2 ) + ( mid >> 12 );
+}
+
+//divides two numbers
+//  uint32_t num - the numerator
+//  uint32_t den - the denominator, more than num/4
+//  returns uint32_t - num/den in Q30
+uint32_t trig_div(uint32_t num, uint32_t den){
+  uint32_t result;
+  int32_t rest;
+
+  if( num == 0 ){
+    return 0;
+  }
+
+  //scale both up as far as they go, so what's left over below is precise
+  while( (num < 0x80000000UL) && (den < 0x80000000UL) ){
+    num <<= 1;
+    den <<= 1;
+  }
+
+  //the 16 bit divide is close, and what it left over is small enough for
+  // another one to finish the job
+  result = trig_div16(num, den);
+  rest = (int32_t)( num - trig_umul30(den, result) );
+  if( rest < 0 ){
+    result -= trig_div16(-(uint32_t)rest, den);
+  } else {
+    result += trig_div16(rest, den);
+  }
+
+  return result;
+}
+
+//calculates the arctangent of a ratio
+//  uint32_t t - the ratio, a Q30 number from 0 to 1
+//  returns angle_t - atan(t), from 0 to 45 degrees
+angle_t trig_atan(uint32_t t){
+  return trig_lerp(trig_atan_table, t);
+}
+
+//calculates the angle of the vector (x,y), like atan2 in libm
+//  (NOTE: x and y can be in any units as long as they are the same)
+//  int32_t y, x - the vector
+//  returns angle_t - the angle, 0 if x and y are both 0
+angle_t trig_atan2(int32_t y, int32_t x){
+  uint32_t ax = (x < 0) ? -(uint32_t)x : (uint32_t)x;
+  uint32_t ay = (y < 0) ? -(uint32_t)y : (uint32_t)y;
+  angle_t result;
+
+  //fold everything into the first octant, where the table is
+  if( ay <= ax ){
+    result = trig_atan( trig_div(ay, ax) );
+  } else {
+    result = ANGLE_90 - trig_atan( trig_div(ax, ay) );
+  }
+
+  //...then unfold it
+  if( x < 0 ){
+    result = ANGLE_180 - result;
+  }
+  if( y < 0 ){
+    result = -result;
+  }
+
+  return result;
+}
+
+//calculates a square root
+//  uint32_t x - a Q30 number from 0 to just under 4
+//  returns uint32_t - sqrt(x) in Q30
+uint32_t trig_sqrt(uint32_t x){
+  uint8_t shift = 0;
+  uint32_t bit = 1UL << 30;
+  uint32_t root = 0;
+  uint32_t n;
+  int32_t rest;
+
+  if( x == 0 ){
+    return 0;
+  }
+
+  //normalize by an even number of bits so the 16 bit root is as precise as
+  // it can be
+  while( x < 0x40000000UL ){
+    x <<= 2;
+    shift++;
+  }
+
+  //digit by digit integer square root
+  n = x;
+  while( bit != 0 ){
+    if( n >= root + bit ){
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  //sqrt(x*2^30) is the Q30 root of the normalized x...
+  root <<= 15;
+
+  //...which is good to 16 bits, one step of Newton's method doubles that
+  // (root + (x - root^2)/(2*root), where x - root^2 is small)
+  rest = (int32_t)( x - trig_umul30(root, root) );
+  if( rest < 0 ){
+    root -= trig_div16(-(uint32_t)rest, root) >> 1;
+  } else {
+    root += trig_div16(rest, root) >> 1;
+  }
+
+  //take the normalization back out
+  return ( root + ((1UL << shift) >> 1) ) >> shift;
+}
@@ -0,0 +1,110 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#ifndef __TRIG_H
+#define __TRIG_H
+
+#include <inttypes.h>
+
+//Integer trig kernels for the navigation math.
+//
+//Angles are binary: the full circle is 2^32, so they wrap around on their
+//own and a signed angle_t cast gives -180 to 180 degrees. Results of sin and
+//cos, and the ratios/square roots below, are Q30 fixed point (TRIG_ONE is
+//1.0). The sin and atan tables come from trigtables/trigtables.c, which the
+//Makefile runs on the build host.
+//
+//Error bounds (checked against double precision on the build host):
+//  trig_sin, trig_cos - within 5e-6 absolute (linear interpolation over 256
+//                        steps per quadrant), and within 2e-5 relative for
+//                        results over 1e-4
+//  trig_atan, atan2    - within 1.3e-6 radians, and within 3e-5 relative for
+//                        angles over 1e-4 radians (from the nearest axis, for
+//                        atan2)
+//  trig_div            - within 4 Q30 units (a rounded 16 bit divide, then
+//                        another one on what it left over)
+//  trig_sqrt           - within 2 Q30 units (a 16 bit root, then a step of
+//                        Newton's method)
+typedef uint32_t angle_t;
+
+//binary angle constants
+#define ANGLE_90  0x40000000UL
+#define ANGLE_180 0x80000000UL
+
+//1.0 in Q30
+#define TRIG_ONE (1L<<30)
+
+//converts a fixed point coordinate into a binary angle
+//  int32_t coord - the angle in units of 1e-7 degrees
+//  returns angle_t - the same angle as a binary angle
+angle_t trig_coord_to_angle(int32_t coord);
+
+//converts a binary angle to whole degrees, rounding to the nearest one
+//  angle_t a - the angle
+//  returns int16_t - the angle in degrees, from -180 to 180
+int16_t trig_angle_to_deg(angle_t a);
+
+//multiplies a number by a Q30 number
+//  int32_t a - the number to multiply (Q30, or any other units)
+//  int32_t b - the Q30 number, from -1 to 1
+//  returns int32_t - a*b in the units of a
+int32_t trig_mul(int32_t a, int32_t b);
+
+//finds the length of an arc
+//  angle_t a - the angle of the arc, from 0 to just under 360 degrees
+//  uint32_t circle - the length of the whole circle, in any units
+//  returns uint32_t - the length of the arc in the same units, rounded down
+uint32_t trig_arc(angle_t a, uint32_t circle);
+
+//calculates the sine of an angle
+//  angle_t a - the angle
+//  returns int32_t - sin(a) in Q30
+int32_t trig_sin(angle_t a);
+
+//calculates the cosine of an angle
+//  angle_t a - the angle
+//  returns int32_t - cos(a) in Q30
+int32_t trig_cos(angle_t a);
+
+//divides two numbers
+//  uint32_t num - the numerator
+//  uint32_t den - the denominator, more than num/4
+//  returns uint32_t - num/den in Q30
+uint32_t trig_div(uint32_t num, uint32_t den);
+
+//calculates the arctangent of a ratio
+//  uint32_t t - the ratio, a Q30 number from 0 to 1
+//  returns angle_t - atan(t), from 0 to 45 degrees
+angle_t trig_atan(uint32_t t);
+
+//calculates the angle of the vector (x,y), like atan2 in libm
+//  (NOTE: x and y can be in any units as long as they are the same)
+//  int32_t y, x - the vector
+//  returns angle_t - the angle, 0 if x and y are both 0
+angle_t trig_atan2(int32_t y, int32_t x);
+
+//calculates a square root
+//  uint32_t x - a Q30 number from 0 to just under 4
+//  returns uint32_t - sqrt(x) in Q30
+uint32_t trig_sqrt(uint32_t x);
+
+#endif
@@ -0,0 +1,58 @@
+//generates the lookup tables used by trig.c
+//  usage: trigtables > trig_tables.h
+//  (run on the build host, the top level Makefile does this automatically)
+
+#include <stdio.h>
+#include <math.h>
+
+//these have to match trig.h
+#define TABLE_BITS 8
+#define TABLE_LEN ((1<<TABLE_BITS)+1)
+#define Q30 1073741824.0
+//binary angle units per radian (the full circle is 2^32)
+#define ANGLE_PER_RAD (4294967296.0/(2*M_PI))
+
+//prints a table of unsigned 32 bit values
+//  const char* name - the name of the table
+//  const char* desc - a comment describing the table
+//  double (*fn)(int) - calculates entry i of the table
+void print_table(const char* name, const char* desc, double (*fn)(int)){
+  int i;
+
+  printf("//%s\n", desc);
+  printf("static const uint32_t PROGMEM %s[TRIG_TABLE_LEN] = {\n", name);
+  for(i=0; i<TABLE_LEN; i++){
+    printf("%s%10luUL,", ((i%5)==0)?"  ":" ", (unsigned long)llround(fn(i)));
+    if( ((i%5)==4) || (i==(TABLE_LEN-1)) ){
+      printf("\n");
+    }
+  }
+  printf("};\n\n");
+}
+
+//sin over the first quadrant, in Q30
+double sin_entry(int i){
+  return sin((M_PI/2)*i/(TABLE_LEN-1))*Q30;
+}
+
+//atan of ratios from 0 to 1, in binary angle units
+double atan_entry(int i){
+  return atan((double)i/(TABLE_LEN-1))*ANGLE_PER_RAD;
+}
+
+int main(){
+  printf("//generated by trigtables/trigtables.c, do not edit\n\n");
+  printf("#ifndef __TRIG_TABLES_H\n");
+  printf("#define __TRIG_TABLES_H\n\n");
+  printf("#define TRIG_TABLE_BITS %d\n", TABLE_BITS);
+  printf("#define TRIG_TABLE_LEN %d\n\n", TABLE_LEN);
+
+  print_table("trig_sin_table",
+              "sin(x) for x from 0 to 90 degrees, in Q30", sin_entry);
+  print_table("trig_atan_table",
+              "atan(t) for t from 0 to 1, in binary angle units", atan_entry);
+
+  printf("#endif\n");
+
+  return 0;
+}
@@ -11,16 +11,52 @@
 #error "This UART library does not support your AVR, please modify uart.c"
 #endif
 
+#if (UART_RX_BUF_LEN & (UART_RX_BUF_LEN-1)) || (UART_RX_BUF_LEN > 256)
+#error "UART_RX_BUF_LEN must be a power of two no larger than 256"
+#endif
+
+#define UART_RX_MASK (UART_RX_BUF_LEN-1)
+
+//receive ring buffer
+//  the ISR is the only writer of rx_head and the main program is the only
+//  writer of rx_tail, and both are single bytes, so no locking is needed
+static volatile char rx_buf[UART_RX_BUF_LEN];
+static volatile uint8_t rx_head = 0;
+static volatile uint8_t rx_tail = 0;
+static volatile uint8_t rx_overruns = 0;
+
+//stores each received byte in the ring buffer
+ISR(USART0_RX_vect){
+  char data = UDR0;
+  uint8_t next = (rx_head+1) & UART_RX_MASK;
+
+  //if the buffer is full, drop the byte rather than clobber unread data
+  if( next == rx_tail ){
+    if( rx_overruns != 0xFF ){
+      rx_overruns++;
+    }
+  } else {
+    rx_buf[rx_head] = data;
+    rx_head = next;
+  }
+}
+
 //initialize a uart
 void uart_init(unsigned long baudrate){
-  baudrate = (F_CPU/16/baudrate-1); //massage the baud rate
+  //massage the baud rate (double speed mode divides by 8 instead of 16, which
+  // keeps 115200 exact at 7.3728MHz)
+  baudrate = (F_CPU/8/baudrate-1);
 
   //Set baud rate
   UBRR0H = (uint8_t)(baudrate>>8);
   UBRR0L = (uint8_t)baudrate;
+  UCSR0A = (1<<U2X0);
+
+  //throw away anything left over from before
+  rx_tail = rx_head;
 
-  //Enable receiver and transmitter
-  UCSR0B = (1<<RXEN0)|(1<<TXEN0);
+  //Enable receiver, receive interrupt and transmitter
+  UCSR0B = (1<<RXEN0)|(1<<RXCIE0)|(1<<TXEN0);
 
   //NOTE: some devices require the URSEL bit to be set in this step
   //Set frame format to 8 data bits, no parity, 1 stop bit
@@ -43,14 +79,39 @@ inline char uart_get(void){
   char result;
 
   //wait until a byte has been received
-  while((UCSR0A&(1<<RXC0)) == 0) {};
-
-  //get received data
-  result = UDR0;
+  while( !uart_poll(&result) ) {};
 
   return result;
 }
 
+//gets a received byte if there is one, without waiting
+// char* data - where to store the byte
+// returns uint8_t - 0 if nothing has been received, 1 otherwise
+uint8_t uart_poll(char* data){
+  uint8_t tail = rx_tail;
+
+  if( tail == rx_head ){
+    return 0;
+  }
+
+  *data = rx_buf[tail];
+  //only advance the tail after the byte has been read out
+  rx_tail = (tail+1) & UART_RX_MASK;
+
+  return 1;
+}
+
+//returns uint8_t - the number of received bytes waiting to be read
+uint8_t uart_available(void){
+  return (rx_head - rx_tail) & UART_RX_MASK;
+}
+
+//returns uint8_t - the number of bytes dropped because the receive buffer
+//  was full (saturates at 255)
+uint8_t uart_overruns(void){
+  return rx_overruns;
+}
+
 //prints a nibble (4 bits) in hexadecimal
 //  uint8_t nibble - the nibble to print (only 4 lowest bits used)
 void uart_print4(uint8_t nibble){
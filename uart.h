@@ -8,7 +8,13 @@
 //The example Makefile supplied with this library does this.
 // e.g.: #define F_CPU 8000000
 
+//size of the receive ring buffer in bytes (must be a power of two and no
+//larger than 256, and holds one less than that, 22ms at 115200 baud)
+#define UART_RX_BUF_LEN 256
+
 //initialize a uart
+//  (NOTE: received bytes are buffered by an interrupt, so interrupts must be
+//   enabled with sei() before anything will be received)
 void uart_init(unsigned long baudrate);
 
 //send a byte
@@ -19,6 +25,18 @@ inline void uart_send(char data);
 // returns char - the data received
 inline char uart_get(void);
 
+//gets a received byte if there is one, without waiting
+// char* data - where to store the byte
+// returns uint8_t - 0 if nothing has been received, 1 otherwise
+uint8_t uart_poll(char* data);
+
+//returns uint8_t - the number of received bytes waiting to be read
+uint8_t uart_available(void);
+
+//returns uint8_t - the number of bytes dropped because the receive buffer
+//  was full (saturates at 255)
+uint8_t uart_overruns(void);
+
 //prints a nibble (4 bits) in hexadecimal
 //  uint8_t nibble - the nibble to print (only 4 lowest bits used)
 void uart_print4(uint8_t nibble);
@@ -0,0 +1,132 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#include <inttypes.h>
+#include "ubx.h"
+
+//adds a byte to a parser's running checksum
+static inline void ubx_checksum(ubx_parser_t* p, uint8_t c){
+  p->ck_a += c;
+  p->ck_b += p->ck_a;
+}
+
+//resets a parser so it waits for the start of the next message
+//  ubx_parser_t* p - the parser to reset
+void ubx_init(ubx_parser_t* p){
+  p->state = UBX_SYNC1;
+}
+
+//feeds a received byte to a parser
+//  (NOTE: messages longer than UBX_MAX_PAYLOAD are dropped as soon as their
+//   length comes in, the payload is only valid until the next call to
+//   ubx_feed)
+//  ubx_parser_t* p - the parser
+//  uint8_t c - the byte that was received
+//  returns uint8_t - 1 if p now holds a complete message with a good
+//    checksum, 0 otherwise
+uint8_t ubx_feed(ubx_parser_t* p, uint8_t c){
+  uint8_t result = 0;
+
+  switch( p->state ){
+    case UBX_SYNC1:
+      if( c == UBX_SYNC_CHAR1 ){
+        p->state = UBX_SYNC2;
+      }
+      break;
+    case UBX_SYNC2:
+      if( c == UBX_SYNC_CHAR2 ){
+        p->state = UBX_CLASS;
+      } else if( c != UBX_SYNC_CHAR1 ){ //(0xB5 0xB5 0x62 still starts one)
+        p->state = UBX_SYNC1;
+      }
+      break;
+    case UBX_CLASS:
+      //the checksum covers everything from here to the end of the payload
+      p->ck_a = 0;
+      p->ck_b = 0;
+      ubx_checksum(p, c);
+      p->msg_class = c;
+      p->state = UBX_ID;
+      break;
+    case UBX_ID:
+      ubx_checksum(p, c);
+      p->msg_id = c;
+      p->state = UBX_LEN1;
+      break;
+    case UBX_LEN1:
+      ubx_checksum(p, c);
+      p->len = c;
+      p->state = UBX_LEN2;
+      break;
+    case UBX_LEN2:
+      ubx_checksum(p, c);
+      p->len |= (uint16_t)c << 8;
+      p->pos = 0;
+      //a length that won't fit is either a message that isn't wanted or
+      // garbage, so look for the next one instead of waiting it out
+      if( p->len > UBX_MAX_PAYLOAD ){
+        p->state = UBX_SYNC1;
+      } else {
+        p->state = (p->len == 0) ? UBX_CK_A : UBX_PAYLOAD;
+      }
+      break;
+    case UBX_PAYLOAD:
+      ubx_checksum(p, c);
+      p->payload[p->pos] = c;
+      p->pos++;
+      if( p->pos == p->len ){
+        p->state = UBX_CK_A;
+      }
+      break;
+    case UBX_CK_A:
+      p->state = (c == p->ck_a) ? UBX_CK_B : UBX_SYNC1;
+      break;
+    default: //UBX_CK_B
+      p->state = UBX_SYNC1;
+      result = (c == p->ck_b);
+      break;
+  }
+
+  return result;
+}
+
+//checks what a complete message is
+//  const ubx_parser_t* p - the parser holding the message
+//  uint8_t msg_class, msg_id - the message to check for
+//  returns uint8_t - 1 if it's that message, 0 otherwise
+uint8_t ubx_is(const ubx_parser_t* p, uint8_t msg_class, uint8_t msg_id){
+  return (p->msg_class == msg_class) && (p->msg_id == msg_id);
+}
+
+//decodes a little-endian 16 bit field of a payload
+//  const ubx_parser_t* p - the parser holding the message
+//  uint8_t offset - where in the payload the field starts
+uint16_t ubx_u16(const ubx_parser_t* p, uint8_t offset){
+  return p->payload[offset] | ((uint16_t)p->payload[offset+1] << 8);
+}
+
+//decodes a little-endian 32 bit field of a payload
+//  const ubx_parser_t* p - the parser holding the message
+//  uint8_t offset - where in the payload the field starts
+uint32_t ubx_u32(const ubx_parser_t* p, uint8_t offset){
+  return ubx_u16(p, offset) | ((uint32_t)ubx_u16(p, offset+2) << 16);
+}
@@ -0,0 +1,96 @@
+/***
+Copyright (C) 2012 David DiPaola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***/
+
+#ifndef __UBX_H
+#define __UBX_H
+
+#include <inttypes.h>
+
+//the two bytes every UBX message starts with
+#define UBX_SYNC_CHAR1 0xB5
+#define UBX_SYNC_CHAR2 0x62
+
+//message classes and IDs we use
+#define UBX_CLASS_NAV    0x01
+#define UBX_ID_NAV_PVT   0x07 //position, velocity and time, once per fix
+#define UBX_CLASS_ACK    0x05
+#define UBX_ID_ACK_NAK   0x00
+#define UBX_ID_ACK_ACK   0x01
+#define UBX_CLASS_CFG    0x06
+#define UBX_ID_CFG_PRT   0x00
+#define UBX_ID_CFG_MSG   0x01
+#define UBX_ID_CFG_RATE  0x08
+
+//payload length of NAV-PVT, the longest message we parse
+#define UBX_NAV_PVT_LEN 92
+#define UBX_MAX_PAYLOAD UBX_NAV_PVT_LEN
+
+//states of the message framer
+#define UBX_SYNC1   0 //waiting for UBX_SYNC_CHAR1
+#define UBX_SYNC2   1 //waiting for UBX_SYNC_CHAR2
+#define UBX_CLASS   2
+#define UBX_ID      3
+#define UBX_LEN1    4 //low byte of the payload length
+#define UBX_LEN2    5 //high byte of the payload length
+#define UBX_PAYLOAD 6
+#define UBX_CK_A    7
+#define UBX_CK_B    8
+
+//assembles UBX messages one byte at a time, checking the checksum as it goes
+struct ubx_parser {
+  uint8_t payload[UBX_MAX_PAYLOAD]; //the payload, little-endian
+  uint8_t msg_class, msg_id;
+  uint16_t len;       //payload length, from the header
+  uint16_t pos;       //number of payload bytes received so far
+  uint8_t ck_a, ck_b; //the running 8-bit Fletcher checksum
+  uint8_t state;      //one of the UBX_* framer states
+};
+typedef struct ubx_parser ubx_parser_t;
+
+//resets a parser so it waits for the start of the next message
+//  ubx_parser_t* p - the parser to reset
+void ubx_init(ubx_parser_t* p);
+
+//feeds a received byte to a parser
+//  (NOTE: messages longer than UBX_MAX_PAYLOAD are dropped as soon as their
+//   length comes in, the payload is only valid until the next call to
+//   ubx_feed)
+//  ubx_parser_t* p - the parser
+//  uint8_t c - the byte that was received
+//  returns uint8_t - 1 if p now holds a complete message with a good
+//    checksum, 0 otherwise
+uint8_t ubx_feed(ubx_parser_t* p, uint8_t c);
+
+//checks what a complete message is
+//  const ubx_parser_t* p - the parser holding the message
+//  uint8_t msg_class, msg_id - the message to check for
+//  returns uint8_t - 1 if it's that message, 0 otherwise
+uint8_t ubx_is(const ubx_parser_t* p, uint8_t msg_class, uint8_t msg_id);
+
+//decodes little-endian fields of a payload
+//  const ubx_parser_t* p - the parser holding the message
+//  uint8_t offset - where in the payload the field starts
+uint16_t ubx_u16(const ubx_parser_t* p, uint8_t offset);
+uint32_t ubx_u32(const ubx_parser_t* p, uint8_t offset);
+#define ubx_i32(p, offset) ((int32_t)ubx_u32((p), (offset)))
+
+#endif
@@ -20,7 +20,6 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ***/
 
-#include <util/delay.h>
 #include <avr/pgmspace.h> //for program space storage
 #include <stdio.h> //for sprintf and NULL
 #include "ui.h"
@@ -28,8 +27,12 @@ SOFTWARE.
 #include "keypad.h"
 #include "keys.h" //definitions for keypad keys
 #include "lcd.h"
+#include "lcd_fb.h" //for drawing without flicker
+#include "lcd_glyph.h" //for custom glyphs
 #include "storage.h" //for EEPROM storage
 #include "gps.h" //for loc_state_t
+#include "coord_dist.h" //for the distance models
+#include "tick.h" //for timing messages
 
 //time zone
 //uncomment to enable timezone time correction
@@ -38,11 +41,6 @@ SOFTWARE.
 static const int8_t TIME_ZONE = -7;
 #endif
 
-//EEPROM constraints (change EEPROM_SIZE depending on your MCU)
-#define SLOT_SIZE (sizeof(float)*2)
-#define EEPROM_SIZE 2048
-#define NUM_SLOTS (EEPROM_SIZE/SLOT_SIZE)
-
 //constants
 //length of the small buffer used when printing things to the screen
 static const uint8_t SMALL_BUF_LEN = LCD_DISP_LENGTH+1; //from lcdlibrary/lcd.h
@@ -50,30 +48,149 @@ static const uint8_t SMALL_BUF_LEN = LCD_DISP_LENGTH+1; //from lcdlibrary/lcd.h
 static const uint8_t MAX_GREAT_DOP = 2;
 static const uint8_t MAX_GOOD_DOP = 5;
 static const uint8_t MAX_ACCEPTABLE_DOP = 10;
-//how long to wait for message display (in milliseconds)
+//how long to show messages for (in milliseconds)
 static const uint16_t MSG_WAIT = 2000;
-//which row to draw the destination info on
-static const uint8_t DEST_ROW = 0;
-//which row to draw the page on
-static const uint8_t PAGE_ROW = 1;
-//page numbers for the various pages
-static const uint8_t SAT_PAGE = 0;
-static const uint8_t DRIVING_PAGE = 1;
-static const uint8_t MEM_PAGE = 2;
-static const uint8_t DESTLOC_PAGE = 3;
-static const uint8_t CURRLOC_PAGE = 4;
-static const uint8_t MIN_PAGE = 0; //(sat page)
-static const uint8_t MAX_PAGE = 4; //(current location page)
+//what the page row is doing, besides the pages
+static const uint8_t PAGES_MODE = 0;      //showing a page
+static const uint8_t LOAD_HOW_MODE = 1;   //asking to type or load the dest
+static const uint8_t LOAD_SLOT_MODE = 2;  //asking which slot to load
+static const uint8_t SAVE_WHICH_MODE = 3; //asking to save the dest or currloc
+static const uint8_t SAVE_SLOT_MODE = 4;  //asking which slot to save to
+static const uint8_t DEST_LAT_MODE = 5;   //asking for the dest latitude...
+static const uint8_t DEST_LONG_MODE = 6;  //...and longitude
+static const uint8_t MESSAGE_MODE = 7;    //showing a message for MSG_WAIT
 //minimum number of satellites required
 static const uint8_t MIN_SATS = 3;
+//letters for the distance models, indexed by DIST_MODEL_*
+static const char PROGMEM DIST_MODEL_CHARS[] = "FSE";
+
+//the lines of info the screen is made of
+#define LINE_DEST    0 //distance and which way to go
+#define LINE_SAT     1 //dilution of precision, number of sats, time
+#define LINE_DRIVING 2 //speed, distance model, altitude
+#define LINE_MEM     3 //load or save
+#define LINE_DESTLOC 4 //destination coordinates
+#define LINE_CURRLOC 5 //current coordinates
+#define LINE_SIGNAL  6 //signal bars
+
+//the fields the lines are made of
+#define FIELD_DIST     0
+#define FIELD_CARDINAL 1
+#define FIELD_ARROW    2
+#define FIELD_DELTA    3
+#define FIELD_DOP      4
+#define FIELD_SATS     5
+#define FIELD_TIME     6
+#define FIELD_SPEED    7
+#define FIELD_MODEL    8
+#define FIELD_ALT      9
+#define FIELD_MEM      10
+#define FIELD_DESTLOC  11
+#define FIELD_CURRLOC  12
+#define FIELD_SIGNAL   13
+
+//where a field goes in its line
+struct ui_field {
+  uint8_t line;  //one of the LINE_* lines
+  uint8_t field; //one of the FIELD_* fields
+  uint8_t col;   //the column, from the start of the line
+};
+
+//where a line goes on the screen
+struct ui_slot {
+  uint8_t line; //one of the LINE_* lines
+  uint8_t col;
+  uint8_t row;
+};
 
-//signal meter glyphs
-static const uint8_t FULL_SIG_CHAR = 0;
-static const uint8_t GOOD_SIG_CHAR = 1;
-static const uint8_t LOW_SIG_CHAR = 2;
-static const uint8_t BAD_SIG_CHAR = 3;
-static const uint8_t SIG_METER_LEN = (8*4);
-static const char PROGMEM SIG_METER[] = {
+//the fields of each line, spread out when there's room for it
+#if LCD_DISP_LENGTH >= 20
+  #define UI_LINE_LENGTH 20
+  static const struct ui_field PROGMEM UI_FIELDS[] = {
+    {LINE_DEST, FIELD_DIST, 0},
+    {LINE_DEST, FIELD_CARDINAL, 10},
+    {LINE_DEST, FIELD_ARROW, 13},
+    {LINE_DEST, FIELD_DELTA, 15},
+    {LINE_SAT, FIELD_DOP, 0},
+    {LINE_SAT, FIELD_SATS, 2},
+    {LINE_SAT, FIELD_TIME, 12},
+    {LINE_DRIVING, FIELD_SPEED, 0},
+    {LINE_DRIVING, FIELD_MODEL, 11},
+    {LINE_DRIVING, FIELD_ALT, 14},
+    {LINE_MEM, FIELD_MEM, 0},
+    {LINE_DESTLOC, FIELD_DESTLOC, 0},
+    {LINE_CURRLOC, FIELD_CURRLOC, 0},
+    {LINE_SIGNAL, FIELD_SIGNAL, 0},
+  };
+#else
+  #define UI_LINE_LENGTH 16
+  static const struct ui_field PROGMEM UI_FIELDS[] = {
+    {LINE_DEST, FIELD_DIST, 0},
+    {LINE_DEST, FIELD_CARDINAL, 8},
+    {LINE_DEST, FIELD_ARROW, 10},
+    {LINE_DEST, FIELD_DELTA, 11},
+    {LINE_SAT, FIELD_DOP, 0},
+    {LINE_SAT, FIELD_SATS, 1},
+    {LINE_SAT, FIELD_TIME, 8},
+    {LINE_DRIVING, FIELD_SPEED, 0},
+    {LINE_DRIVING, FIELD_MODEL, 9},
+    {LINE_DRIVING, FIELD_ALT, 11},
+    {LINE_MEM, FIELD_MEM, 0},
+    {LINE_DESTLOC, FIELD_DESTLOC, 0},
+    {LINE_CURRLOC, FIELD_CURRLOC, 0},
+    {LINE_SIGNAL, FIELD_SIGNAL, 0},
+  };
+#endif
+#define UI_NUM_FIELDS (sizeof(UI_FIELDS)/sizeof(UI_FIELDS[0]))
+
+//which lines are always on the screen, and where the rest are paged through
+// (the prompts and messages go there too)
+#if LCD_LINES >= 4
+  //e.g. 20x4, the sat and driving info fit under the destination info
+  static const struct ui_slot PROGMEM UI_FIXED[] = {
+    {LINE_DEST, 0, 0},
+    {LINE_SAT, 0, 1},
+    {LINE_DRIVING, 0, 2},
+  };
+  static const uint8_t PROGMEM UI_PAGES[] = {
+    LINE_MEM, LINE_DESTLOC, LINE_CURRLOC, LINE_SIGNAL
+  };
+  #define UI_PAGE_COL 0
+  #define UI_PAGE_ROW 3
+#elif (LCD_LINES >= 2) && (LCD_DISP_LENGTH >= 2*UI_LINE_LENGTH)
+  //e.g. 40x2, two lines side by side on each row
+  static const struct ui_slot PROGMEM UI_FIXED[] = {
+    {LINE_DEST, 0, 0},
+    {LINE_SAT, UI_LINE_LENGTH, 0},
+    {LINE_DRIVING, 0, 1},
+  };
+  static const uint8_t PROGMEM UI_PAGES[] = {
+    LINE_MEM, LINE_DESTLOC, LINE_CURRLOC, LINE_SIGNAL
+  };
+  #define UI_PAGE_COL UI_LINE_LENGTH
+  #define UI_PAGE_ROW 1
+#elif LCD_LINES >= 2
+  //e.g. 16x2, just the destination info and a page
+  static const struct ui_slot PROGMEM UI_FIXED[] = {
+    {LINE_DEST, 0, 0},
+  };
+  static const uint8_t PROGMEM UI_PAGES[] = {
+    LINE_SAT, LINE_DRIVING, LINE_MEM, LINE_DESTLOC, LINE_CURRLOC, LINE_SIGNAL
+  };
+  #define UI_PAGE_COL 0
+  #define UI_PAGE_ROW 1
+#else
+  #error "the UI needs an LCD with at least 2 lines"
+#endif
+#define UI_NUM_FIXED (sizeof(UI_FIXED)/sizeof(UI_FIXED[0]))
+#define UI_NUM_PAGES (sizeof(UI_PAGES)/sizeof(UI_PAGES[0]))
+
+//signal meter glyphs (LCD_GLYPH_SIZE bytes each)
+static const uint8_t FULL_SIG_GLYPH = 0;
+static const uint8_t GOOD_SIG_GLYPH = 1;
+static const uint8_t LOW_SIG_GLYPH = 2;
+static const uint8_t BAD_SIG_GLYPH = 3;
+static const uint8_t PROGMEM SIG_METER[] = {
   //full signal
   0b00011111,
   0b00000000,
@@ -112,24 +229,269 @@ static const char PROGMEM SIG_METER[] = {
   0b00000100,
 };
 
+//signal bar glyphs, bar i is i+1 pixels high
+// (each SIGNAL_BAR_DB of SNR is another pixel, 8 pixels is a strong signal,
+//  and is drawn with the LCD's own solid block so the bars never need more
+//  than 7 glyphs, leaving one for the arrow, and the DOP meter shares them
+//  when they're on the screen, see ui_draw_field)
+static const uint8_t SIGNAL_BAR_DB = 6;
+static const uint8_t SIGNAL_BAR_MAX = 8;
+static const char SIGNAL_BAR_FULL_CHAR = '\xFF';
+static const uint8_t PROGMEM SIGNAL_BARS[] = {
+  //1 pixel
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00001110,
+  //2 pixels
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00001110,
+  0b00001110,
+  //3 pixels
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  //4 pixels
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  //5 pixels
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  //6 pixels
+  0b00000000,
+  0b00000000,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  //7 pixels
+  0b00000000,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+  0b00001110,
+};
+
+//arrow glyphs for which way to turn, in 22.5 degree steps clockwise from
+//straight ahead
+static const uint8_t ARROW_DIRECTIONS = 16;
+static const uint8_t PROGMEM ARROWS[] = {
+  //0 degrees (ahead)
+  0b00000100,
+  0b00001110,
+  0b00010101,
+  0b00000100,
+  0b00000100,
+  0b00000100,
+  0b00000100,
+  0b00000000,
+  //22.5 degrees
+  0b00000010,
+  0b00000111,
+  0b00000010,
+  0b00000100,
+  0b00000100,
+  0b00001000,
+  0b00001000,
+  0b00000000,
+  //45 degrees
+  0b00000000,
+  0b00001111,
+  0b00000011,
+  0b00000101,
+  0b00001001,
+  0b00010000,
+  0b00000000,
+  0b00000000,
+  //67.5 degrees
+  0b00000000,
+  0b00000000,
+  0b00000010,
+  0b00000111,
+  0b00011010,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  //90 degrees (right)
+  0b00000000,
+  0b00000100,
+  0b00000010,
+  0b00011111,
+  0b00000010,
+  0b00000100,
+  0b00000000,
+  0b00000000,
+  //112.5 degrees
+  0b00000000,
+  0b00000000,
+  0b00011010,
+  0b00000111,
+  0b00000010,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  //135 degrees
+  0b00000000,
+  0b00010000,
+  0b00001001,
+  0b00000101,
+  0b00000011,
+  0b00001111,
+  0b00000000,
+  0b00000000,
+  //157.5 degrees
+  0b00001000,
+  0b00001000,
+  0b00000100,
+  0b00000100,
+  0b00000010,
+  0b00000111,
+  0b00000010,
+  0b00000000,
+  //180 degrees (behind)
+  0b00000100,
+  0b00000100,
+  0b00000100,
+  0b00000100,
+  0b00010101,
+  0b00001110,
+  0b00000100,
+  0b00000000,
+  //202.5 degrees
+  0b00000010,
+  0b00000010,
+  0b00000100,
+  0b00000100,
+  0b00001000,
+  0b00011100,
+  0b00001000,
+  0b00000000,
+  //225 degrees
+  0b00000000,
+  0b00000001,
+  0b00010010,
+  0b00010100,
+  0b00011000,
+  0b00011110,
+  0b00000000,
+  0b00000000,
+  //247.5 degrees
+  0b00000000,
+  0b00000000,
+  0b00001011,
+  0b00011100,
+  0b00001000,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  //270 degrees (left)
+  0b00000000,
+  0b00000100,
+  0b00001000,
+  0b00011111,
+  0b00001000,
+  0b00000100,
+  0b00000000,
+  0b00000000,
+  //292.5 degrees
+  0b00000000,
+  0b00000000,
+  0b00001000,
+  0b00011100,
+  0b00001011,
+  0b00000000,
+  0b00000000,
+  0b00000000,
+  //315 degrees
+  0b00000000,
+  0b00011110,
+  0b00011000,
+  0b00010100,
+  0b00010010,
+  0b00000001,
+  0b00000000,
+  0b00000000,
+  //337.5 degrees
+  0b00001000,
+  0b00011100,
+  0b00001000,
+  0b00000100,
+  0b00000100,
+  0b00000010,
+  0b00000010,
+  0b00000000,
+};
+
 //variables
-//stores the state of the bottom line
+//which of UI_PAGES is up
 static uint8_t bottom_screen = 0;
 //a timer
 static uint8_t timer = 0;
-
-//initializes the LCD and loads custom glyphs
+//one of the *_MODE modes
+static uint8_t mode = PAGES_MODE;
+//the slot or coordinate being typed in
+static prompt_t prompt;
+//the destination latitude, while the longitude is typed in
+static int32_t dest_lat;
+//1 if the current location is being saved, 0 for the destination
+static uint8_t save_currloc;
+//the message being shown, when it goes away, and the mode to go back to
+static const char* message;
+static tick_timer_t message_timer;
+static uint8_t message_next = PAGES_MODE;
+
+//initializes the LCD
+//  (NOTE: custom glyphs are loaded as they're drawn, see lcd_glyph.h)
 void ui_init(){
-  uint8_t i;
-
   //LCD on
   lcd_init(LCD_DISP_ON);
+  lcd_fb_init();
+  lcd_glyph_init();
+}
 
-  //load signal meter glyphs
-  lcd_command(_BV(LCD_CGRAM));
-  for(i=0; i<SIG_METER_LEN; i++){
-    lcd_data(pgm_read_byte_near(&SIG_METER[i]));
-  }
+//draws an arrow pointing the way to turn
+//  int16_t degrees - how far to turn, clockwise
+static void ui_print_arrow( int16_t degrees ){
+  uint8_t direction;
+
+  //round to the nearest arrow
+  degrees = (degrees+360) % 360;
+  direction = ( ((uint16_t)degrees*ARROW_DIRECTIONS + 180)/360 ) %
+              ARROW_DIRECTIONS;
+
+  //(the degrees are printed right after, so it can do without)
+  lcd_fb_putc( lcd_glyph(&ARROWS[direction*LCD_GLYPH_SIZE], ' ') );
 }
 
 //prints one of 8 cardinal directions to the LCD
@@ -137,291 +499,431 @@ void ui_init(){
 void ui_print_cardinal(const int16_t degrees){
 
   if( (23 <= degrees) && (degrees <= 67) ){
-    lcd_puts_P("NE");
+    lcd_fb_puts_P("NE");
   }
   if( (68 <= degrees) && (degrees <= 112) ){
-    lcd_puts_P("E");
+    lcd_fb_puts_P("E");
   }
   if( (113 <= degrees) && (degrees <= 157) ){
-    lcd_puts_P("SE");
+    lcd_fb_puts_P("SE");
   }
   if( (158 <= degrees) && (degrees <= 202) ){
-    lcd_puts_P("S");
+    lcd_fb_puts_P("S");
   }
   if( (203 <= degrees) && (degrees <= 247) ){
-    lcd_puts_P("SW");
+    lcd_fb_puts_P("SW");
   }
   if( (248 <= degrees) && (degrees <= 292) ){
-    lcd_puts_P("W");
+    lcd_fb_puts_P("W");
   }
   if( (293 <= degrees) && (degrees <= 337) ){
-    lcd_puts_P("NW");
+    lcd_fb_puts_P("NW");
   }
   if( (338 <= degrees) || (degrees <= 21) ){
-    lcd_puts_P("N");
+    lcd_fb_puts_P("N");
   }
 }
 
-//reads the keypad for a yes or no answer
-//  returns char - 0 if 4 was pressed, 1 if 6 was pressed
-char ui_choice(){
-  char result = 0;
-  char button;
-
-  //wait for all buttons to be released
-  while( keypad_getchar() != NO_BUTTON ) {}
-  //wait for user to enter a choice
-  do{
-    button = keypad_getchar();
-  }while((button != '4') && (button != '6'));
-  if( button == '6' ){
-    result = 1;
+//checks if a line is on the screen
+//  uint8_t line - one of the LINE_* lines
+//  returns uint8_t - 1 if it's always up or its page is, 0 otherwise
+static uint8_t ui_showing( uint8_t line ){
+  uint8_t i;
+
+  if( pgm_read_byte_near(&UI_PAGES[bottom_screen]) == line ){
+    return 1;
+  }
+  for(i=0; i<UI_NUM_FIXED; i++){
+    if( pgm_read_byte_near(&UI_FIXED[i].line) == line ){
+      return 1;
+    }
   }
 
-  return result;
+  return 0;
 }
 
-//draws a single line with destination info
-//  const uint8_t row - the row to draw the line on
+//draws a field of info at the current position
+//  uint8_t field - one of the FIELD_* fields
 //  const loc_state_t* loc - GPS location information
-void ui_draw_dest_info( const uint8_t row, const loc_state_t* loc ){
+static void ui_draw_field( uint8_t field, const loc_state_t* loc ){
   char small_buffer[SMALL_BUF_LEN];
+  const gps_sat_t* sats;
+  uint8_t count, i, height;
+  int dop;
 
-  lcd_clearline(row);
-  lcd_gotoxy(0, row);
-
-  //only print info if we have enough satellites
-  if( (loc->sats) >= MIN_SATS ){
+  if( field == FIELD_DIST ){
     //print the distance
     if( (loc->distance) >= 1000000ul ){ //megameters
       sprintf_P( small_buffer,
-                 PSTR("%lu.%dMm"),
+                 PSTR("%lu.%02dMm"),
                  (unsigned long)(loc->distance)/1000000ul,
-                 (int16_t)((loc->distance)/10000ul)%100 );
-      lcd_puts( small_buffer );
+                 (int16_t)(((loc->distance)/10000ul)%100) );
     } else if( (loc->distance) >= 1000 ){ //kilometers
       sprintf_P( small_buffer,
-                 PSTR("%lu.%dkm"),
+                 PSTR("%lu.%02dkm"),
                  (unsigned long)(loc->distance)/1000,
-                 (int16_t)((loc->distance)/10)%100 );
-      lcd_puts( small_buffer );
+                 (int16_t)(((loc->distance)/10)%100) );
     } else { //meters
       sprintf_P( small_buffer,
                  PSTR("%lum"),
                  (unsigned long)(loc->distance) );
-      lcd_puts( small_buffer );
     }
-
-    lcd_gotoxy(8, row);
+    lcd_fb_puts( small_buffer );
+  } else if( field == FIELD_CARDINAL ){
     //direction of travel
     ui_print_cardinal( loc->heading );
-
+  } else if( field == FIELD_ARROW ){
+    //which way to go, at a glance
+    ui_print_arrow( loc->deltaHeading );
+  } else if( field == FIELD_DELTA ){
     //print the heading (the \xDF is for something that looks like a degree
     // symbol)
-    lcd_gotoxy(11, row);
     sprintf_P( small_buffer, PSTR("%d\xDF"), loc->deltaHeading );
-    lcd_puts( small_buffer );
-  } else {
-    lcd_puts_P("Too few sats");
+    lcd_fb_puts( small_buffer );
+  } else if( field == FIELD_DOP ){
+    //print out the dilution of precision meter
+    dop = gps_get_dop();
+    if( dop <= MAX_GREAT_DOP ){ //if dop is ideal or excellent
+      i = FULL_SIG_GLYPH;
+    } else if( dop <= MAX_GOOD_DOP ){ //if dop is good
+      i = GOOD_SIG_GLYPH;
+    } else if( dop <= MAX_ACCEPTABLE_DOP ){ //if dop is moderate
+      i = LOW_SIG_GLYPH;
+    } else { //if dop is fair or poor
+      i = BAD_SIG_GLYPH;
+    }
+    //with the signal bars up too (when the sat info is always on the
+    // screen), only the arrow's slot is left over from them, so the meter is
+    // drawn as a bar 2 pixels shorter for each step down
+    if( !ui_showing(LINE_SIGNAL) ){
+      lcd_fb_putc( lcd_glyph(&SIG_METER[i*LCD_GLYPH_SIZE], '?') );
+    } else if( i == FULL_SIG_GLYPH ){
+      lcd_fb_putc(SIGNAL_BAR_FULL_CHAR);
+    } else {
+      height = SIGNAL_BAR_MAX - 2*i;
+      lcd_fb_putc( lcd_glyph(&SIGNAL_BARS[(height-1)*LCD_GLYPH_SIZE], '?') );
+    }
+  } else if( field == FIELD_SATS ){
+    //number of satellites
+    sprintf_P( small_buffer, PSTR("%dst"), loc->sats );
+    lcd_fb_puts( small_buffer );
+  } else if( field == FIELD_TIME ){
+    //time in HH:MM:SS
+    sprintf_P( small_buffer,
+               PSTR("%lu:%lu:%lu"),
+               (((loc->time)/10000)
+                 #ifdef USE_TIME_ZONE
+                 +24+TIME_ZONE)%24
+                 #else
+                 )
+                 #endif
+               ,
+               ((loc->time)%10000)/100,
+               (loc->time)%100);
+    lcd_fb_puts( small_buffer );
+  } else if( field == FIELD_SPEED ){
+    //print out the speed
+    // (cm/s to km/h is *3600/100000)
+    sprintf_P( small_buffer, PSTR("%dkm/h"), (int)((gps_get_speed()*9)/250) );
+    lcd_fb_puts( small_buffer );
+  } else if( field == FIELD_MODEL ){
+    //print out which model found the distance (Flat, Sphere or Ellipsoid)
+    lcd_fb_putc( pgm_read_byte_near(&DIST_MODEL_CHARS[loc->dist_model]) );
+  } else if( field == FIELD_ALT ){
+    //print out the altitude
+    sprintf_P( small_buffer, PSTR("%dm"), (int)(gps_get_altitude()/100) );
+    lcd_fb_puts( small_buffer );
+  } else if( field == FIELD_MEM ){
+    lcd_fb_puts_P("4)LOAD    6)SAVE");
+  } else if( field == FIELD_DESTLOC ){
+    if( (timer & _BV(2)) == 0 ){
+      lcd_fb_puts_P("DLa ");
+      print_coord(loc->dest_lat);
+    } else {
+      lcd_fb_puts_P("DLo ");
+      print_coord(loc->dest_long);
+    }
+  } else if( field == FIELD_CURRLOC ){
+    if( (timer & _BV(2)) == 0 ){
+      lcd_fb_puts_P("CLa ");
+      print_coord(loc->curr_lat);
+    } else {
+      lcd_fb_puts_P("CLo ");
+      print_coord(loc->curr_long);
+    }
+  } else if( field == FIELD_SIGNAL ){
+    count = gps_get_sats(&sats);
+    if( count == 0 ){
+      lcd_fb_puts_P("No sats in view");
+      return;
+    }
+
+    //one bar per satellite, in the order the GPS sent them
+    for(i=0; (i<count) && (i<UI_LINE_LENGTH); i++){
+      //(any signal at all gets at least one pixel)
+      height = (sats[i].snr + SIGNAL_BAR_DB-1)/SIGNAL_BAR_DB;
+      if( height > SIGNAL_BAR_MAX ){
+        height = SIGNAL_BAR_MAX;
+      }
+
+      if( height == 0 ){ //not being tracked
+        lcd_fb_putc('_');
+      } else if( height == SIGNAL_BAR_MAX ){
+        lcd_fb_putc(SIGNAL_BAR_FULL_CHAR);
+      } else {
+        lcd_fb_putc( lcd_glyph(&SIGNAL_BARS[(height-1)*LCD_GLYPH_SIZE], '|') );
+      }
+    }
   }
 }
 
-//draws a single line with GPS satellite info
-//  const uint8_t row - the row to draw the line on
+//draws a line of info, one field at a time (see UI_FIELDS)
+//  uint8_t line - one of the LINE_* lines
+//  uint8_t col - the column the line starts at
+//  uint8_t row - the row to draw the line on
 //  const loc_state_t* loc - GPS location information
-void ui_draw_sat_info( const uint8_t row, const loc_state_t* loc ){
-  char small_buffer[SMALL_BUF_LEN];
+static void ui_draw_line( uint8_t line, uint8_t col, uint8_t row,
+                          const loc_state_t* loc ){
+  uint8_t i;
 
-  lcd_clearline(row);
-  lcd_gotoxy(0, row);
-
-  //print out the dilution of precision meter
-  lcd_gotoxy(0, row);
-  if( (loc->dop) <= MAX_GREAT_DOP ){ //if dop is ideal or excellent
-    lcd_putc(FULL_SIG_CHAR);
-  } else if( (loc->dop) <= MAX_GOOD_DOP ){ //if dop is good
-    lcd_putc(GOOD_SIG_CHAR);
-  } else if( (loc->dop) <= MAX_ACCEPTABLE_DOP ){ //if dop is moderate
-    lcd_putc(LOW_SIG_CHAR);
-  } else { //if dop is fair or poor
-    lcd_putc(BAD_SIG_CHAR);
+  //only print destination info if we have enough satellites
+  if( (line == LINE_DEST) && ((loc->sats) < MIN_SATS) ){
+    lcd_fb_gotoxy(col, row);
+    lcd_fb_puts_P("Too few sats");
+    return;
   }
 
-  //number of satellites
-  lcd_gotoxy(1, row);
-  sprintf_P( small_buffer, PSTR("%dst"), loc->sats );
-  lcd_puts( small_buffer );
-
-  //time in HH:MM:SS
-  lcd_gotoxy(8, row);
-  sprintf_P( small_buffer,
-             PSTR("%lu:%lu:%lu"),
-             (((loc->time)/10000)
-               #ifdef USE_TIME_ZONE
-               +24+TIME_ZONE)%24
-               #else
-               )
-               #endif
-             ,
-             ((loc->time)%10000)/100,
-             (loc->time)%100);
-  lcd_puts( small_buffer );
+  for(i=0; i<UI_NUM_FIELDS; i++){
+    if( pgm_read_byte_near(&UI_FIELDS[i].line) == line ){
+      lcd_fb_gotoxy(col + pgm_read_byte_near(&UI_FIELDS[i].col), row);
+      ui_draw_field(pgm_read_byte_near(&UI_FIELDS[i].field), loc);
+    }
+  }
 }
 
-//draws a single line with driving info
-//  const uint8_t row - the row to draw the line on
-//  const loc_state_t* loc - GPS location information
-void ui_draw_driving_info( const uint8_t row, const loc_state_t* loc ){
-  char small_buffer[SMALL_BUF_LEN];
-
-  lcd_clearline(row);
-  lcd_gotoxy(0, row);
+//shows a message on the bottom row for a while
+//  const char* PROGMEM msg - the message
+static void ui_show_message( const char* PROGMEM msg ){
+  message = msg;
+  message_next = PAGES_MODE;
+  tick_timer_start(&message_timer, MSG_WAIT);
+  mode = MESSAGE_MODE;
+}
 
-  //print out the speed
-  lcd_gotoxy(0, row);
-  sprintf_P( small_buffer, PSTR("%dkm/h"), (int)(loc->speed) );
-  lcd_puts( small_buffer );
+//says a coordinate that was typed in is no good, and then asks for it again
+//  (NOTE: call this in the coordinate's prompt mode)
+static void ui_reprompt(){
+  uint8_t again = mode;
 
-  //print out the altitude
-  lcd_gotoxy(11, row);
-  sprintf_P( small_buffer, PSTR("%dm"), (int)loc->altitude );
-  lcd_puts( small_buffer );
+  ui_show_message(PSTR("INVALID"));
+  message_next = again;
+  prompt_start(&prompt, 1);
 }
 
-//asks the user what latitude and longitude to set the destination to
-//  loc_state_t* loc - where to write the destination information to
-void ui_enter_dest_screen(loc_state_t* loc){
-  lcd_clrscr();
-
-  //get destination information
-  lcd_clrscr();
-  lcd_puts_P("Enter the goal\nLatitude...");
-  _delay_ms(MSG_WAIT);
-  (loc->dest_lat) = prompt_float();
-
-  lcd_clrscr();
-  lcd_puts_P("Enter the goal\nLongitude...");
-  _delay_ms(MSG_WAIT);
-  (loc->dest_long) = prompt_float();
+//takes a key for the pages
+//  char button - the key that was pressed
+//  returns uint8_t - 1 if the screen needs redrawing, 0 otherwise
+static uint8_t ui_page_input( char button ){
+  uint8_t result = 1;
+
+  if( button == LEFT_BUTTON ){
+    bottom_screen = ( (bottom_screen == 0) ? UI_NUM_PAGES : bottom_screen ) - 1;
+  } else if( button == RIGHT_BUTTON ){
+    bottom_screen = (bottom_screen+1) % UI_NUM_PAGES;
+  } else if( ui_showing(LINE_DRIVING) && (button == PRECISE_BUTTON) ){
+    //the precise (ellipsoid) distance model is toggled from here
+    dist_set_precise( !dist_get_precise() );
+  } else if( ui_showing(LINE_MEM) && (button == '4') ){
+    mode = LOAD_HOW_MODE;
+  } else if( ui_showing(LINE_MEM) && (button == '6') ){
+    mode = SAVE_WHICH_MODE;
+  } else {
+    result = 0;
+  }
+
+  return result;
 }
 
-//asks the user what slot thay wish to load data from and loads the data into
-//the destination portions of a location state
-//  loc_state_t* loc - the location state to store data to
-void ui_load_screen(loc_state_t* loc){
-  char load_from_mem;
+//takes a key for the destination and slot prompts
+//  loc_state_t* loc - the location state to load to or save from
+//  char button - the key that was pressed
+static void ui_prompt_input( loc_state_t* loc, char button ){
+  int32_t dest_lon;
   uint16_t slot;
+  char success;
 
-  lcd_clrscr();
-  lcd_puts_P("Load how?\n4)TYPE     6)MEM");
-
-  load_from_mem = ui_choice();
-
-  if( load_from_mem ){
-    lcd_clrscr();
-    lcd_puts_P("Load which slot?");
-    slot = prompt_uint16(1); //ROW 1
+  if( !prompt_key(&prompt, button) ){
+    return;
+  }
 
-    lcd_clrscr();
-    if( slot < (NUM_SLOTS-1) ){
+  if( mode == DEST_LAT_MODE ){
+    //on to the longitude
+    if( prompt_coord(&prompt, 90, &dest_lat) ){
+      prompt_start(&prompt, 1);
+      mode = DEST_LONG_MODE;
+    } else {
+      ui_reprompt();
+    }
+  } else if( mode == DEST_LONG_MODE ){
+    if( prompt_coord(&prompt, 180, &dest_lon) ){
+      gps_set_dest( loc, dest_lat, dest_lon );
+      mode = PAGES_MODE;
+    } else {
+      ui_reprompt();
+    }
+  } else if( mode == LOAD_SLOT_MODE ){
+    slot = prompt_uint16(&prompt);
+    if( slot < CONFIG_SLOT ){
       read_dest(slot, loc);
-      lcd_puts_P("LOADED");
+      ui_show_message(PSTR("LOADED"));
     } else {
-      lcd_puts_P("INVALID SLOT!");
+      ui_show_message(PSTR("INVALID SLOT!"));
+    }
+  } else if( mode == SAVE_SLOT_MODE ){
+    slot = prompt_uint16(&prompt);
+    if( slot < CONFIG_SLOT ){
+      if( save_currloc ){
+        success = store_loc(slot);
+      } else {
+        success = store_dest(slot, loc);
+      }
+
+      if( !success ){
+        ui_show_message(PSTR("SAVE FAILED!"));
+      } else {
+        ui_show_message(PSTR("SAVED"));
+      }
+    } else {
+      ui_show_message(PSTR("INVALID SLOT!"));
     }
-    _delay_ms(MSG_WAIT);
-  } else {
-    ui_enter_dest_screen(loc);
   }
 }
 
-//asks the user what slot they wish to save the destination to
-//  const loc_state_t* loc - the location data to be read
-void ui_save_screen(const loc_state_t* loc){
-  uint16_t slot;
-  uint8_t save_currloc = 0;
-  //char button;
-  char success;
+//checks if holding a key down should keep repeating it
+//  char button - the key
+//  returns uint8_t - 1 when flipping through the pages or typing in digits, 0
+//    otherwise
+static uint8_t ui_repeats( char button ){
+  uint8_t result;
 
-  lcd_clrscr();
-  lcd_puts_P("Save which?\n4)DEST 6)CURRLOC");
-  save_currloc = ui_choice();
+  if( mode == PAGES_MODE ){
+    result = (button == LEFT_BUTTON) || (button == RIGHT_BUTTON);
+  } else {
+    result = ( (mode == DEST_LAT_MODE) || (mode == DEST_LONG_MODE) ||
+               (mode == LOAD_SLOT_MODE) || (mode == SAVE_SLOT_MODE) ) &&
+             (button != ENTER_BUTTON);
+  }
 
-  lcd_clrscr();
-  lcd_puts_P("Save to where?");
-  slot = prompt_uint16(1); //ROW 1
+  return result;
+}
 
-  lcd_clrscr();
-  if( slot < (NUM_SLOTS-1) ){
-    if( save_currloc ){
-      success = store_loc(slot, loc);
-    } else {
-      success = store_dest(slot, loc);
+//takes the next key press, one step of whatever screen is up
+//  (NOTE: this never waits, so GPS updates keep coming in behind the load and
+//   save screens)
+//  loc_state_t* loc - the location data to use/modify
+//  returns uint8_t - 1 if the screen needs redrawing, 0 otherwise
+uint8_t ui_input(loc_state_t* loc){
+  keypad_event_t e;
+  char button = NO_BUTTON;
+  uint8_t result = 1;
+
+  //presses count, and so do repeats where they're useful (the rest of the
+  // events are skipped)
+  while( (button == NO_BUTTON) && keypad_get_event(&e) ){
+    if( (e.type == KEYPAD_PRESS) ||
+        ((e.type == KEYPAD_REPEAT) && ui_repeats(e.key)) ){
+      button = e.key;
     }
+  }
 
-    if( !success ){
-      lcd_puts_P("SAVE FAILED!");
+  if( mode == MESSAGE_MODE ){
+    //messages go away on their own (keys pressed until then are dropped)
+    if( tick_timer_expired(&message_timer) ){
+      mode = message_next;
+    } else {
+      result = 0;
+    }
+  } else if( button == NO_BUTTON ){
+    result = 0;
+  } else if( mode == PAGES_MODE ){
+    result = ui_page_input(button);
+  } else if( mode == LOAD_HOW_MODE ){
+    //type in the destination, or load it from memory
+    if( button == '4' ){
+      prompt_start(&prompt, 1);
+      mode = DEST_LAT_MODE;
+    } else if( button == '6' ){
+      prompt_start(&prompt, 0);
+      mode = LOAD_SLOT_MODE;
     } else {
-      lcd_puts_P("SAVED");
+      result = 0;
+    }
+  } else if( mode == SAVE_WHICH_MODE ){
+    //save the destination, or where we are
+    if( (button == '4') || (button == '6') ){
+      save_currloc = (button == '6');
+      prompt_start(&prompt, 0);
+      mode = SAVE_SLOT_MODE;
+    } else {
+      result = 0;
     }
   } else {
-    lcd_puts_P("INVALID SLOT!");
+    ui_prompt_input(loc, button);
   }
 
-  _delay_ms(MSG_WAIT);
+  return result;
 }
 
-//draws UI elements to the screen and accepts user input
-//  loc_state_t* loc - the location data to use/modify
-void ui_update(loc_state_t* loc){
-  char curr_button = NO_BUTTON;
-
+//draws UI elements to the screen after an update from the GPS
+//  const loc_state_t* loc - the location data to use
+void ui_update(const loc_state_t* loc){
   timer++;
 
-  curr_button = keypad_getchar();
-  if( curr_button == LEFT_BUTTON ){
-    bottom_screen--;
-  } else if( curr_button == RIGHT_BUTTON ){
-    bottom_screen++;
+  ui_redraw(loc);
+}
+
+//draws UI elements to the screen
+//  (NOTE: for redrawing between updates, see gps_predict)
+//  const loc_state_t* loc - the location data to use
+void ui_redraw(const loc_state_t* loc){
+  uint8_t prompting = 0;
+  uint8_t i;
+
+  //the screen is drawn from scratch, but only what changed is sent to the LCD
+  // (see lcd_fb_flush)
+  lcd_fb_clrscr();
+  lcd_glyph_frame();
+  //draw the lines that are always up, whatever the page row is doing
+  for(i=0; i<UI_NUM_FIXED; i++){
+    ui_draw_line( pgm_read_byte_near(&UI_FIXED[i].line),
+                  pgm_read_byte_near(&UI_FIXED[i].col),
+                  pgm_read_byte_near(&UI_FIXED[i].row), loc );
   }
-  //if(bottom_screen > MAX_PAGE){
-    //bottom_screen = MIN_PAGE;
-  //}
-  bottom_screen = bottom_screen % (MAX_PAGE+1);
-
-  lcd_clrscr();
-  //draw the destination info on row 0
-  ui_draw_dest_info(DEST_ROW, loc);
-
-  if( bottom_screen == SAT_PAGE ){
-    ui_draw_sat_info(PAGE_ROW, loc);
-  } else if( bottom_screen == DRIVING_PAGE ){
-    ui_draw_driving_info(PAGE_ROW, loc);
-  } else if( bottom_screen == MEM_PAGE ){
-    lcd_gotoxy(0, PAGE_ROW);
-    lcd_puts_P("4)LOAD    6)SAVE");
-    if( curr_button == '4' ){
-      ui_load_screen(loc);
-    } else if( curr_button == '6' ){
-      ui_save_screen(loc);
-    }
-  } else if( bottom_screen == DESTLOC_PAGE ){
-    lcd_gotoxy(0, PAGE_ROW);
-    if( (timer & _BV(2)) == 0 ){
-      lcd_puts_P("DLa ");
-      print_float(loc->dest_lat);
-    } else {
-      lcd_puts_P("DLo ");
-      print_float(loc->dest_long);
-    }
-  } else if( bottom_screen == CURRLOC_PAGE ){
-    lcd_gotoxy(0, PAGE_ROW);
-    if( (timer & _BV(2)) == 0 ){
-      lcd_puts_P("CLa ");
-      print_float(loc->curr_lat);
+
+  lcd_fb_gotoxy(UI_PAGE_COL, UI_PAGE_ROW);
+  if( mode == PAGES_MODE ){
+    ui_draw_line( pgm_read_byte_near(&UI_PAGES[bottom_screen]),
+                  UI_PAGE_COL, UI_PAGE_ROW, loc );
+  } else if( mode == LOAD_HOW_MODE ){
+    lcd_fb_puts_P("4)TYPE     6)MEM");
+  } else if( mode == SAVE_WHICH_MODE ){
+    lcd_fb_puts_P("4)DEST 6)CURRLOC");
+  } else if( mode == MESSAGE_MODE ){
+    lcd_fb_puts_p(message);
+  } else {
+    //the prompts draw last, so the cursor is left where the next digit goes
+    if( mode == DEST_LAT_MODE ){
+      prompt_draw(&prompt, PSTR("La"), UI_PAGE_COL, UI_PAGE_ROW);
+    } else if( mode == DEST_LONG_MODE ){
+      prompt_draw(&prompt, PSTR("Lo"), UI_PAGE_COL, UI_PAGE_ROW);
+    } else if( mode == LOAD_SLOT_MODE ){
+      prompt_draw(&prompt, PSTR("Load"), UI_PAGE_COL, UI_PAGE_ROW);
     } else {
-      lcd_puts_P("CLo ");
-      print_float(loc->curr_long);
+      prompt_draw(&prompt, PSTR("Save to"), UI_PAGE_COL, UI_PAGE_ROW);
     }
+    prompting = 1;
   }
+
+  lcd_fb_cursor(prompting);
+  lcd_fb_flush();
 }
@@ -26,43 +26,28 @@ SOFTWARE.
 #include <inttypes.h>
 #include "gps.h" //for loc_state_t
 
-//initializes the LCD and loads custom glyphs
+//initializes the LCD
+//  (NOTE: custom glyphs are loaded as they're drawn, see lcd_glyph.h)
 void ui_init();
 
 //prints one of 8 cardinal directions to the LCD
 //  const int16_t degrees - the input, in degrees
 void ui_print_cardinal(const int16_t degrees);
 
-//draws a single line with destination info
-//  const uint8_t row - the row to draw the line on
-//  const loc_state_t* loc - GPS location information
-void ui_draw_dest_info( const uint8_t row, const loc_state_t* loc );
-
-//draws a single line with GPS satellite info
-//  const uint8_t row - the row to draw the line on
-//  const loc_state_t* loc - GPS location information
-void ui_draw_sat_info( const uint8_t row, const loc_state_t* loc );
-
-//draws a single line with driving info
-//  const uint8_t row - the row to draw the line on
-//  const loc_state_t* loc - GPS location information
-void ui_draw_driving_info( const uint8_t row, const loc_state_t* loc );
-
-//asks the user what latitude and longitude to set the destination to
-//  loc_state_t* loc - where to write the destination information to
-void ui_enter_dest_screen(loc_state_t* loc);
-
-//asks the user what slot thay wish to load data from and loads the data into
-//the destination portions of a location state
-//  loc_state_t* loc - the location state to store data to
-void ui_load_screen(loc_state_t* loc);
+//takes the next key press, one step of whatever screen is up
+//  (NOTE: this never waits, so GPS updates keep coming in behind the load and
+//   save screens)
+//  loc_state_t* loc - the location data to use/modify
+//  returns uint8_t - 1 if the screen needs redrawing, 0 otherwise
+uint8_t ui_input(loc_state_t* loc);
 
-//asks the user what slot they wish to save the destination to
-//  const loc_state_t* loc - the location data to be read
-void ui_save_screen(const loc_state_t* loc);
+//draws UI elements to the screen after an update from the GPS
+//  const loc_state_t* loc - the location data to use
+void ui_update(const loc_state_t* loc);
 
-//draws UI elements to the screen and accepts user input
-//  loc_state_t* loc - the location data to use/modify
-void ui_update(loc_state_t* loc);
+//draws UI elements to the screen
+//  (NOTE: for redrawing between updates, see gps_predict)
+//  const loc_state_t* loc - the location data to use
+void ui_redraw(const loc_state_t* loc);
 
 #endif